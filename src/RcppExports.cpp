@@ -7,8 +7,8 @@
 using namespace Rcpp;
 
 // cppTAfact
-RcppExport SEXP cppTAfact(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP, double lambda, int itersMax, double tol, double tolA, double tolT);
-RcppExport SEXP MeDeCom_cppTAfact(SEXP mDtSEXPSEXP, SEXP mTtinitSEXPSEXP, SEXP mAinitSEXPSEXP, SEXP lambdaSEXP, SEXP itersMaxSEXP, SEXP tolSEXP, SEXP tolASEXP, SEXP tolTSEXP) {
+RcppExport SEXP cppTAfact(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP, double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads, std::string precision, int streamBlock, std::string checkpoint, int checkpointEvery, bool resume, bool profile, std::string traceFile, std::string traceLabel, int fixedRows, IntegerVector pinnedCpGs, IntegerVector pinnedSamples, NumericVector lowerA, NumericVector upperA);
+RcppExport SEXP MeDeCom_cppTAfact(SEXP mDtSEXPSEXP, SEXP mTtinitSEXPSEXP, SEXP mAinitSEXPSEXP, SEXP lambdaSEXP, SEXP itersMaxSEXP, SEXP tolSEXP, SEXP tolASEXP, SEXP tolTSEXP, SEXP nthreadsSEXP, SEXP precisionSEXP, SEXP streamBlockSEXP, SEXP checkpointSEXP, SEXP checkpointEverySEXP, SEXP resumeSEXP, SEXP profileSEXP, SEXP traceFileSEXP, SEXP traceLabelSEXP, SEXP fixedRowsSEXP, SEXP pinnedCpGsSEXP, SEXP pinnedSamplesSEXP, SEXP lowerASEXP, SEXP upperASEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -20,13 +20,83 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
     Rcpp::traits::input_parameter< double >::type tolA(tolASEXP);
     Rcpp::traits::input_parameter< double >::type tolT(tolTSEXP);
-    rcpp_result_gen = Rcpp::wrap(cppTAfact(mDtSEXP, mTtinitSEXP, mAinitSEXP, lambda, itersMax, tol, tolA, tolT));
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< int >::type streamBlock(streamBlockSEXP);
+    Rcpp::traits::input_parameter< std::string >::type checkpoint(checkpointSEXP);
+    Rcpp::traits::input_parameter< int >::type checkpointEvery(checkpointEverySEXP);
+    Rcpp::traits::input_parameter< bool >::type resume(resumeSEXP);
+    Rcpp::traits::input_parameter< bool >::type profile(profileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type traceFile(traceFileSEXP);
+    Rcpp::traits::input_parameter< std::string >::type traceLabel(traceLabelSEXP);
+    Rcpp::traits::input_parameter< int >::type fixedRows(fixedRowsSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type pinnedCpGs(pinnedCpGsSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type pinnedSamples(pinnedSamplesSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type lowerA(lowerASEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type upperA(upperASEXP);
+    rcpp_result_gen = Rcpp::wrap(cppTAfact(mDtSEXP, mTtinitSEXP, mAinitSEXP, lambda, itersMax, tol, tolA, tolT, nthreads, precision, streamBlock, checkpoint, checkpointEvery, resume, profile, traceFile, traceLabel, fixedRows, pinnedCpGs, pinnedSamples, lowerA, upperA));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cppTAfactMulti
+RcppExport SEXP cppTAfactMulti(SEXP mDtSEXP, SEXP mTtinitsSEXP, SEXP mAinitsSEXP, double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads, std::string precision, int streamBlock);
+RcppExport SEXP MeDeCom_cppTAfactMulti(SEXP mDtSEXPSEXP, SEXP mTtinitsSEXPSEXP, SEXP mAinitsSEXPSEXP, SEXP lambdaSEXP, SEXP itersMaxSEXP, SEXP tolSEXP, SEXP tolASEXP, SEXP tolTSEXP, SEXP nthreadsSEXP, SEXP precisionSEXP, SEXP streamBlockSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type mDtSEXP(mDtSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mTtinitsSEXP(mTtinitsSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mAinitsSEXP(mAinitsSEXPSEXP);
+    Rcpp::traits::input_parameter< double >::type lambda(lambdaSEXP);
+    Rcpp::traits::input_parameter< int >::type itersMax(itersMaxSEXP);
+    Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< double >::type tolA(tolASEXP);
+    Rcpp::traits::input_parameter< double >::type tolT(tolTSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< int >::type streamBlock(streamBlockSEXP);
+    rcpp_result_gen = Rcpp::wrap(cppTAfactMulti(mDtSEXP, mTtinitsSEXP, mAinitsSEXP, lambda, itersMax, tol, tolA, tolT, nthreads, precision, streamBlock));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cppTAfactPath
+RcppExport SEXP cppTAfactPath(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP, NumericVector lambdas, int itersMax, double tol, double tolA, double tolT, int nthreads, std::string precision, int streamBlock);
+RcppExport SEXP MeDeCom_cppTAfactPath(SEXP mDtSEXPSEXP, SEXP mTtinitSEXPSEXP, SEXP mAinitSEXPSEXP, SEXP lambdasSEXP, SEXP itersMaxSEXP, SEXP tolSEXP, SEXP tolASEXP, SEXP tolTSEXP, SEXP nthreadsSEXP, SEXP precisionSEXP, SEXP streamBlockSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type mDtSEXP(mDtSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mTtinitSEXP(mTtinitSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mAinitSEXP(mAinitSEXPSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type lambdas(lambdasSEXP);
+    Rcpp::traits::input_parameter< int >::type itersMax(itersMaxSEXP);
+    Rcpp::traits::input_parameter< double >::type tol(tolSEXP);
+    Rcpp::traits::input_parameter< double >::type tolA(tolASEXP);
+    Rcpp::traits::input_parameter< double >::type tolT(tolTSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type precision(precisionSEXP);
+    Rcpp::traits::input_parameter< int >::type streamBlock(streamBlockSEXP);
+    rcpp_result_gen = Rcpp::wrap(cppTAfactPath(mDtSEXP, mTtinitSEXP, mAinitSEXP, lambdas, itersMax, tol, tolA, tolT, nthreads, precision, streamBlock));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cppSquaredResidual
+double cppSquaredResidual(SEXP mDSEXP, SEXP mTSEXP, SEXP mASEXP, int nthreads);
+RcppExport SEXP MeDeCom_cppSquaredResidual(SEXP mDSEXPSEXP, SEXP mTSEXPSEXP, SEXP mASEXPSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type mDSEXP(mDSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mTSEXP(mTSEXPSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type mASEXP(mASEXPSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cppSquaredResidual(mDSEXP, mTSEXP, mASEXP, nthreads));
     return rcpp_result_gen;
 END_RCPP
 }
 // RHLasso
-List RHLasso(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector l);
-RcppExport SEXP MeDeCom_RHLasso(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP lSEXP) {
+List RHLasso(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector l, int nthreads);
+RcppExport SEXP MeDeCom_RHLasso(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP lSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -34,13 +104,14 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type Winp(WinpSEXP);
     Rcpp::traits::input_parameter< NumericMatrix >::type Ainp(AinpSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type l(lSEXP);
-    rcpp_result_gen = Rcpp::wrap(RHLasso(Ginp, Winp, Ainp, l));
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RHLasso(Ginp, Winp, Ainp, l, nthreads));
     return rcpp_result_gen;
 END_RCPP
 }
 // RQuadHC
-List RQuadHC(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector otol, NumericVector lconstr, NumericVector uconstr);
-RcppExport SEXP MeDeCom_RQuadHC(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP otolSEXP, SEXP lconstrSEXP, SEXP uconstrSEXP) {
+List RQuadHC(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector otol, NumericVector lconstr, NumericVector uconstr, int nthreads);
+RcppExport SEXP MeDeCom_RQuadHC(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP otolSEXP, SEXP lconstrSEXP, SEXP uconstrSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -50,7 +121,27 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type otol(otolSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type lconstr(lconstrSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type uconstr(uconstrSEXP);
-    rcpp_result_gen = Rcpp::wrap(RQuadHC(Ginp, Winp, Ainp, otol, lconstr, uconstr));
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RQuadHC(Ginp, Winp, Ainp, otol, lconstr, uconstr, nthreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// RQuadHCGini
+List RQuadHCGini(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Tinp, double lambdaT, double otol, double f0, double lower, double upper, int nthreads);
+RcppExport SEXP MeDeCom_RQuadHCGini(SEXP GinpSEXP, SEXP WinpSEXP, SEXP TinpSEXP, SEXP lambdaTSEXP, SEXP otolSEXP, SEXP f0SEXP, SEXP lowerSEXP, SEXP upperSEXP, SEXP nthreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericMatrix >::type Ginp(GinpSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type Winp(WinpSEXP);
+    Rcpp::traits::input_parameter< NumericMatrix >::type Tinp(TinpSEXP);
+    Rcpp::traits::input_parameter< double >::type lambdaT(lambdaTSEXP);
+    Rcpp::traits::input_parameter< double >::type otol(otolSEXP);
+    Rcpp::traits::input_parameter< double >::type f0(f0SEXP);
+    Rcpp::traits::input_parameter< double >::type lower(lowerSEXP);
+    Rcpp::traits::input_parameter< double >::type upper(upperSEXP);
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RQuadHCGini(Ginp, Winp, Tinp, lambdaT, otol, f0, lower, upper, nthreads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -68,8 +159,8 @@ BEGIN_RCPP
 END_RCPP
 }
 // RQuadSimplex
-List RQuadSimplex(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector ot);
-RcppExport SEXP MeDeCom_RQuadSimplex(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP otSEXP) {
+List RQuadSimplex(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector ot, int nthreads);
+RcppExport SEXP MeDeCom_RQuadSimplex(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP otSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -77,13 +168,14 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericMatrix >::type Winp(WinpSEXP);
     Rcpp::traits::input_parameter< NumericMatrix >::type Ainp(AinpSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type ot(otSEXP);
-    rcpp_result_gen = Rcpp::wrap(RQuadSimplex(Ginp, Winp, Ainp, ot));
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RQuadSimplex(Ginp, Winp, Ainp, ot, nthreads));
     return rcpp_result_gen;
 END_RCPP
 }
 // RQuadSimplexBox
-List RQuadSimplexBox(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector linp, NumericVector uinp, NumericVector ot);
-RcppExport SEXP MeDeCom_RQuadSimplexBox(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP linpSEXP, SEXP uinpSEXP, SEXP otSEXP) {
+List RQuadSimplexBox(NumericMatrix Ginp, NumericMatrix Winp, NumericMatrix Ainp, NumericVector linp, NumericVector uinp, NumericVector ot, int nthreads);
+RcppExport SEXP MeDeCom_RQuadSimplexBox(SEXP GinpSEXP, SEXP WinpSEXP, SEXP AinpSEXP, SEXP linpSEXP, SEXP uinpSEXP, SEXP otSEXP, SEXP nthreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
@@ -93,7 +185,8 @@ BEGIN_RCPP
     Rcpp::traits::input_parameter< NumericVector >::type linp(linpSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type uinp(uinpSEXP);
     Rcpp::traits::input_parameter< NumericVector >::type ot(otSEXP);
-    rcpp_result_gen = Rcpp::wrap(RQuadSimplexBox(Ginp, Winp, Ainp, linp, uinp, ot));
+    Rcpp::traits::input_parameter< int >::type nthreads(nthreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(RQuadSimplexBox(Ginp, Winp, Ainp, linp, uinp, ot, nthreads));
     return rcpp_result_gen;
 END_RCPP
 }
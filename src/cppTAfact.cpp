@@ -1,11 +1,20 @@
 #include <iostream>
 #include <math.h>
+#include <cmath>
 #include <limits>
 #include <algorithm>
 #include <functional>
 #include <tuple>
 #include <vector>
 #include <type_traits>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
 
 #include <Eigen/Dense>
 #include <Eigen/Cholesky>
@@ -14,6 +23,9 @@
 #include <Rcpp.h>
 #include <RcppEigen.h>
 
+/* The capped simplex of the bounded A-step */
+#include "splxbox.h"
+
 using namespace Rcpp;
 using namespace RcppEigen;
 
@@ -30,9 +42,20 @@ using namespace RcppEigen;
 #include <signal.h>
 #include <unistd.h>
 
+/* Memory-mapped input */
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
 /* to make Eigen thread-safe */
 #include <Eigen/Core>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 using Eigen::Map;
 using Eigen::Dynamic;
 using Eigen::Infinity;
@@ -42,43 +65,77 @@ using RMatrixOut = Eigen::MatrixXd;
 /* Aliases */
 using Double = double;
 
-/* Signal handing */
-bool gotSignal = false;
+/* Signal handing.
+ * The flag is polled by the solver loops (from any thread),
+ * which then wind down and return the current iterate */
+volatile sig_atomic_t gotSignal = 0;
 void setGotSignal(int signum) {
-    gotSignal = true;
+    gotSignal = 1;
 }
 
+/*
+ * Installs the handlers for the duration of a call
+ * and restores the previous ones (i.e. R's) on exit.
+ */
+class SignalGuard {
+    using Handler = void (*)(int);
+
+    Handler oldInt;
+    Handler oldTerm;
+
+public:
+    SignalGuard() {
+        gotSignal = 0;
+        oldInt  = signal(SIGINT, setGotSignal);
+        oldTerm = signal(SIGTERM, setGotSignal);
+    }
+
+    ~SignalGuard() {
+        if (SIG_ERR != oldInt) {
+            signal(SIGINT, oldInt);
+        }
+        if (SIG_ERR != oldTerm) {
+            signal(SIGTERM, oldTerm);
+        }
+    }
+
+    SignalGuard(const SignalGuard&) = delete;
+    SignalGuard& operator=(const SignalGuard&) = delete;
+};
+
 /* Binary operator to get projected gradient
  * while optimizing wrt T
  */
+template <typename Scalar = Double>
 class ProjGradT {
-    Double eps;
+    Scalar eps;
 
 public:
-    ProjGradT(Double tol) : eps(tol)
+    ProjGradT(Scalar tol) : eps(tol)
     {}
 
-    inline Double operator()(const Double& g, const Double& t) const {
+    inline Scalar operator()(const Scalar& g, const Scalar& t) const {
         if (t <= eps) {
-            return std::min(g, 0.0);
+            return std::min(g, Scalar(0));
         }
         else if (eps < t && t < 1 - eps) {
             return g;
         }
         else {
-            return std::max(g, 0.0);
+            return std::max(g, Scalar(0));
         }
     }
 };
 
-template <typename MatrixBig, int DIM = 16, typename Scalar = Double>
+template <int DIM = 16, typename Scalar = Double>
 class ProbSimplexProjector {
 public:
     using Matrix = Eigen::Matrix<Scalar, DIM, Dynamic>;
 
 private:
-    const Matrix mTtD;
-    const Matrix mTtT;
+    /* Owned by the caller, who updates them between the calls to solve() */
+    const Matrix& mTtD;
+    const Matrix& mTtT;
     double tol;
     int itersMax;
 
@@ -88,10 +145,34 @@ private:
     int r;
     int n;
 
+    /* Columns are projected in parallel,
+     * every thread owns 2r scalars of scratch */
+    int nthreads;
+    std::vector<Scalar> scratch;
+
+    /* Iterates of FISTA, allocated once and reused by every solve() */
+    Matrix mAy;
+    Matrix mAnext;
+    Matrix gradA;
+
+    /* Columns of A with known values, n flags or nullptr */
+    const char* pinned = nullptr;
+
+    /* Bounds of the capped simplex, see setBounds(),
+     * every thread owns 2r breakpoints of scratch */
+    bool capped = false;
+    Eigen::Matrix<Scalar, DIM, 1> lower;
+    Eigen::Matrix<Scalar, DIM, 1> upper;
+    std::vector<std::pair<Scalar, int>> breakpoints;
+
 public:
-    ProbSimplexProjector(const MatrixBig& Dt, const Matrix& Tt, double tol, int itersMax)
-        : mTtD(Tt * Dt.transpose()), mTtT(Tt * Tt.transpose()), tol(tol), itersMax(itersMax),
-        r(Tt.rows()), n(Dt.rows())
+    /* mTtD = Tt * Dt^T and mTtT = Tt * Tt^T, the projector keeps references */
+    ProbSimplexProjector(const Matrix& mTtD, const Matrix& mTtT, double tol, int itersMax,
+            int nthreads = 1)
+        : mTtD(mTtD), mTtT(mTtT), tol(tol), itersMax(itersMax),
+        r(mTtD.rows()), n(mTtD.cols()), nthreads(std::max(nthreads, 1)),
+        scratch(DIM == Dynamic ? 2 * r * this->nthreads : 0),
+        mAy(r, n), mAnext(r, n), gradA(r, n)
     {}
 
     void solve(Matrix& mA) {
@@ -99,15 +180,13 @@ public:
         niter = 1;
         optCond = 1e+10;
 
-        double cL = mTtT.operatorNorm() + tol;
-        double lrA = 1.0 / cL;
+        Scalar cL = mTtT.operatorNorm() + tol;
+        Scalar lrA = 1.0 / cL;
 
-        Matrix mAy = mA;
-        Matrix mAnext = Matrix::Zero(r, n);
-        Matrix gradA  = Matrix::Zero(r, n);
-        double tcurr = 1.0, tnext = 1.0;
+        mAy = mA;
+        Scalar tcurr = 1.0, tnext = 1.0;
 
-        while (niter <= itersMax && optCond > tol) {
+        while (niter <= itersMax && optCond > tol && !gotSignal) {
             evalGrad(mAy, gradA);
             mAnext = mAy - lrA * gradA;
             colwiseProjProbSplx(mAnext);
@@ -140,40 +219,316 @@ public:
         return optCond;
     }
 
+    /* Pinned columns get a zero gradient and are not projected,
+     * so they keep the values they enter solve() with */
+    inline void setPinnedColumns(const char* mask) {
+        pinned = mask;
+    }
+
+    /*
+     * Project the columns onto the capped simplex
+     * {a : sum(a) = 1, lo <= a <= up} instead of the probability simplex,
+     * by the exact breakpoint scan of splxbox.h.
+     * The bounds are assumed to pass CheckSplxBox.
+     */
+    void setBounds(const std::vector<double>& lo, const std::vector<double>& up) {
+        capped = true;
+        lower = Eigen::Map<const Eigen::VectorXd>(lo.data(), r).template cast<Scalar>();
+        upper = Eigen::Map<const Eigen::VectorXd>(up.data(), r).template cast<Scalar>();
+        breakpoints.resize(2 * r * nthreads);
+    }
+
 private:
     void evalGrad(const Matrix& A, Matrix& grad) {
-        grad = mTtT * A - mTtD;
+        grad.noalias() = mTtT * A;
+        grad -= mTtD;
+        if (pinned) {
+            for (int colN = 0; colN < n; ++colN) {
+                if (pinned[colN]) {
+                    grad.col(colN).setZero();
+                }
+            }
+        }
     }
 
+    /*
+     * Euclidean projection of every column onto the probability simplex,
+     * done in place. Both paths find the threshold tau of
+     * max(a - tau, 0) without sorting the column.
+     */
     void colwiseProjProbSplx(Matrix& mA) {
-        size_t n = mA.cols();
-        size_t r = mA.rows();
-        Matrix mAcopy = mA;
-
-        //#pragma omp parallel for
-        for (size_t colN = 0; colN < n; ++colN) {
-            auto s = mAcopy.col(colN);
-            std::sort(s.data(), s.data() + s.size(),
-                    std::greater<Double>());
-            bool bget = false;
-            double tmpsum = 0.0, tmax;
-            for (size_t ii = 0; ii < r - 1; ++ii) {
-                tmpsum += s(ii);
-                tmax = (tmpsum - 1.0) / (ii + 1);
-                if (tmax >= s(ii + 1)) {
-                    bget = true;
-                    break;
+        const int ncols = mA.cols();
+
+        #pragma omp parallel for schedule(static) num_threads(nthreads)
+        for (int colN = 0; colN < ncols; ++colN) {
+            if (pinned && pinned[colN]) {
+                continue;
+            }
+            if (capped) {
+                Scalar tau = SplxBoxThreshold(mA.col(colN).data(), lower.data(), upper.data(),
+                        threadBreakpoints(), r);
+                mA.col(colN) = (mA.col(colN).array() - tau).max(lower.array())
+                    .min(upper.array()).matrix();
+                continue;
+            }
+            auto a = mA.col(colN).array();
+            Scalar tau = (DIM != Dynamic) ? thresholdFixed(mA.col(colN))
+                : thresholdCondat(mA.col(colN).data(), threadScratch());
+            a = (a - tau).max(0.0);
+        }
+    }
+
+    /*
+     * Fixed DIM: the active set filtering of Michelot.
+     * Every pass drops the entries below the current threshold,
+     * it is branch-free over the column and stays in registers.
+     */
+    inline Scalar thresholdFixed(const Eigen::Ref<const Eigen::Matrix<Scalar, DIM, 1>>& a) const {
+        const Eigen::Array<Scalar, DIM, 1> y = a;
+        Scalar tau = (y.sum() - 1.0) / r;
+        int nactive = r;
+        while (true) {
+            int nnext = (y > tau).count();
+            tau = ((y > tau).select(y, 0.0).sum() - 1.0) / nnext;
+            if (nnext == nactive) {
+                break;
+            }
+            nactive = nnext;
+        }
+
+        return tau;
+    }
+
+    /*
+     * Dynamic DIM: the algorithm of Condat,
+     * "Fast projection onto the simplex and the l1 ball", 2016.
+     * Expected linear time, scratch holds 2r scalars.
+     */
+    Scalar thresholdCondat(const Scalar* y, Scalar* scratch) const {
+        Scalar* v  = scratch;
+        Scalar* vt = scratch + r;
+        int nv = 0, nvt = 0;
+
+        v[nv++] = y[0];
+        Scalar rho = y[0] - 1.0;
+        for (int i = 1; i < r; ++i) {
+            if (y[i] > rho) {
+                rho += (y[i] - rho) / (nv + 1);
+                if (rho > y[i] - 1.0) {
+                    v[nv++] = y[i];
+                }
+                else {
+                    for (int k = 0; k < nv; ++k) {
+                        vt[nvt++] = v[k];
+                    }
+                    nv = 0;
+                    v[nv++] = y[i];
+                    rho = y[i] - 1.0;
+                }
+            }
+        }
+
+        for (int k = 0; k < nvt; ++k) {
+            if (vt[k] > rho) {
+                v[nv++] = vt[k];
+                rho += (vt[k] - rho) / nv;
+            }
+        }
+
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int k = 0; k < nv;) {
+                if (v[k] <= rho) {
+                    Scalar yk = v[k];
+                    v[k] = v[--nv];
+                    rho += (rho - yk) / nv;
+                    changed = true;
+                }
+                else {
+                    ++k;
                 }
             }
+        }
+
+        return rho;
+    }
+
+    inline std::pair<Scalar, int>* threadBreakpoints() {
+#ifdef _OPENMP
+        return breakpoints.data() + 2 * r * omp_get_thread_num();
+#else
+        return breakpoints.data();
+#endif
+    }
+
+    inline Scalar* threadScratch() {
+#ifdef _OPENMP
+        return scratch.data() + 2 * r * omp_get_thread_num();
+#else
+        return scratch.data();
+#endif
+    }
+};
+
+/*
+ * Factorizations of the principal submatrices of a Gram matrix
+ * indexed by a bitmask of the participating variables.
+ *
+ * All the columns of Tt share the same AAt within an alternation,
+ * so a free set met by one column is factored once and
+ * reused by every other column (and thread) that meets it.
+ * Entries are created lazily and published with a CAS,
+ * a thread that loses the race simply drops its copy.
+ * Only meaningful for fixed (small) DIM,
+ * there are at most 2^DIM subsets.
+ * Next to the factorization an entry keeps the inverse of the
+ * submatrix in the coordinates of AAt, for the batched solver.
+ *
+ * The entries hold fixed-size Eigen members, so they are
+ * heap-allocated through Eigen's aligned operator new
+ * (plain new does not honour their alignment before C++17).
+ * Their total size is capped by entryBudget: once the cap is
+ * reached, get() returns nullptr for unseen subsets and the caller
+ * factors the submatrix itself. With 2^16 subsets of a 16 x 16
+ * Hessian the cache would otherwise grow past 100 MB.
+ */
+template <int DIM = 16, typename Scalar = Double>
+class FreeSetFactorizationCache {
+public:
+    using Matrix = Eigen::Matrix<Scalar, DIM, DIM>;
+    using LDLT   = Eigen::LDLT<Matrix>;
+
+    static const bool enabled = (DIM != Dynamic && DIM <= 16);
+
+    /* Bytes of factorizations kept per alternation */
+    static const size_t entryBudget = size_t(32) << 20;
+
+private:
+    struct Entry {
+        LDLT ldlt;
+        Matrix inverse;
+
+        Entry(const Matrix& AAt, unsigned int mask) {
+            factorSubmatrix(AAt, mask, ldlt, inverse);
+        }
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    Matrix AAt;
+    int r;
+    size_t nslots;
+    size_t entriesMax;
+    std::unique_ptr<std::atomic<Entry*>[]> slots;
+    std::atomic<size_t> nentries;
+
+public:
+    explicit FreeSetFactorizationCache(int r)
+        : AAt(Matrix::Zero(r, r)), r(r), nslots(enabled ? size_t(1) << r : 0),
+        entriesMax(std::max<size_t>(1, entryBudget / sizeof(Entry))),
+        slots(new std::atomic<Entry*>[nslots]), nentries(0)
+    {
+        for (size_t i = 0; i < nslots; ++i) {
+            slots[i].store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    ~FreeSetFactorizationCache() {
+        clear();
+    }
+
+    /* Drops all the factorizations, not thread-safe */
+    void reset(const Matrix& mAAt) {
+        clear();
+        AAt = mAAt;
+    }
+
+    /*
+     * Factors AAt restricted to the variables in mask the way
+     * the cache does, for the callers that find it full,
+     * so that a hit and a miss give the same bits.
+     * The submatrix is stored in the leading block of
+     * a zero-padded r x r matrix, variables in increasing order,
+     * its inverse is scattered back to the coordinates of AAt.
+     */
+    static void factorSubmatrix(const Matrix& AAt, unsigned int mask,
+            LDLT& ldlt, Matrix& inverse) {
+        const int r = AAt.rows();
+        Eigen::Matrix<int, DIM, 1> idx(r);
+        int nsub = 0;
+        for (int i = 0; i < r; ++i) {
+            if (mask & (1u << i)) {
+                idx(nsub++) = i;
+            }
+        }
 
-            if (!bget) {
-                tmax = (tmpsum + s(r - 1) - 1) / r;
+        Matrix AAtSub = Matrix::Zero(r, r);
+        for (int j = 0; j < nsub; ++j) {
+            for (int i = 0; i < nsub; ++i) {
+                AAtSub(i, j) = AAt(idx(i), idx(j));
             }
+        }
+        ldlt.compute(AAtSub);
+
+        Matrix inv = ldlt.solve(Matrix::Identity(r, r));
+        inverse = Matrix::Zero(r, r);
+        for (int j = 0; j < nsub; ++j) {
+            for (int i = 0; i < nsub; ++i) {
+                inverse(idx(i), idx(j)) = inv(i, j);
+            }
+        }
+    }
+
+    /*
+     * Factorization of AAt restricted to the variables in mask,
+     * nullptr if it is not cached and the cache is full.
+     * The submatrix is stored in the leading block of
+     * a zero-padded r x r matrix, variables in increasing order.
+     */
+    const LDLT* get(unsigned int mask) {
+        const Entry* entry = find(mask);
+        return entry ? &entry->ldlt : nullptr;
+    }
+
+    /*
+     * Inverse of AAt restricted to the variables in mask,
+     * zero outside of their rows and columns,
+     * nullptr if it is not cached and the cache is full.
+     */
+    const Matrix* getInverse(unsigned int mask) {
+        const Entry* entry = find(mask);
+        return entry ? &entry->inverse : nullptr;
+    }
 
-            for (size_t jj = 0; jj < r; ++jj) {
-                mA(jj, colN) = std::max(mA(jj, colN) - tmax, 0.0);
+private:
+    const Entry* find(unsigned int mask) {
+        Entry* entry = slots[mask].load(std::memory_order_acquire);
+        if (nullptr == entry) {
+            /* racing threads may overshoot the cap by one entry each */
+            if (nentries.load(std::memory_order_relaxed) >= entriesMax) {
+                return nullptr;
+            }
+            Entry* fresh = new Entry(AAt, mask);
+            if (slots[mask].compare_exchange_strong(entry, fresh,
+                        std::memory_order_acq_rel, std::memory_order_acquire)) {
+                entry = fresh;
+                nentries.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                /* another thread was faster, entry now holds its copy */
+                delete fresh;
             }
         }
+
+        return entry;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < nslots; ++i) {
+            delete slots[i].exchange(nullptr, std::memory_order_relaxed);
+        }
+        nentries.store(0, std::memory_order_relaxed);
     }
 };
 
@@ -187,7 +542,7 @@ public:
 
 private:
     const Matrix AAt;
-    const Vector b;
+    Vector b;
     double tol;
     int itersMax;
     int r;
@@ -199,10 +554,44 @@ private:
 
     Scalar L = 1e+05;
 
+    /* Scratch space of the Newton method.
+     * Kept as members so that a solver instance
+     * can be reused for many right-hand sides
+     * without touching the heap for DIM = Dynamic */
+    VectorIdx fidxv;
+    Vector grad;
+    Vector descent;
+    Vector gradFree;
+    Vector descentFree;
+    Vector tcurr;
+    Matrix AAtFree;
+    Eigen::LDLT<Matrix> ldltFree;
+
+    FreeSetFactorizationCache<DIM, Scalar>* factorizations = nullptr;
+
 public:
     QPBoxSolverSmallDims(const Matrix& AAt, const Vector& b, double tol, int itersMax)
         : AAt(AAt), b(b), tol(tol), itersMax(itersMax), r(AAt.cols())
-    {}
+    {
+        allocateScratch();
+    }
+
+    /* The right-hand side is to be provided with setRhs() */
+    QPBoxSolverSmallDims(const Matrix& AAt, double tol, int itersMax)
+        : AAt(AAt), b(Vector::Zero(AAt.cols(), 1)), tol(tol), itersMax(itersMax), r(AAt.cols())
+    {
+        allocateScratch();
+    }
+
+    inline void setRhs(const Vector& rhs) {
+        b = rhs;
+    }
+
+    /* Share factorizations of the Hessian submatrices,
+     * the cache has to be built for the same AAt */
+    inline void setFactorizationCache(FreeSetFactorizationCache<DIM, Scalar>* cache) {
+        factorizations = FreeSetFactorizationCache<DIM, Scalar>::enabled ? cache : nullptr;
+    }
 
     enum Method {newton = 0, coord_descent, fista, exact_any_rank, exact_rank_2};
 
@@ -252,6 +641,17 @@ public:
 private:
     enum varState {box = 0, zero, one};
 
+    void allocateScratch() {
+        fidxv       = VectorIdx::Zero(r, 1);
+        grad        = Vector::Zero(r, 1);
+        descent     = Vector::Zero(r, 1);
+        gradFree    = Vector::Zero(r, 1);
+        descentFree = Vector::Zero(r, 1);
+        tcurr       = Vector::Zero(r, 1);
+        AAtFree     = Matrix::Zero(r, r);
+        ldltFree    = Eigen::LDLT<Matrix>(r);
+    }
+
     void solveExactAnyRank(Vector& t) {
         VectorIdx stateVec = VectorIdx::Zero(r, 1);
         StateMatrix stateOrder = StateMatrix::Zero(r, 3);
@@ -304,16 +704,27 @@ private:
              * what would the values for box variables be like */
             Vector tbox = Vector::Zero(r, 1);
             if (numState[box] > 0) {
-                Matrix AAtBox = Matrix::Zero(r, r);
                 Vector bBox   = Vector::Zero(r, 1);
+                unsigned int boxMask = 0;
                 for (int j = 0; j < numState[box]; ++j) {
-                    for (int i = 0; i < numState[box]; ++i) {
-                        AAtBox(i, j) = AAt(stateIdx[box](i), stateIdx[box](j));
-                    }
                     bBox(j) = colSumStateOne(stateIdx[box](j)) - b(stateIdx[box](j));
+                    boxMask |= 1u << stateIdx[box](j);
                 }
                 /* solve the system */
-                tbox = -AAtBox.ldlt().solve(bBox);
+                const Eigen::LDLT<Matrix>* cached =
+                    factorizations ? factorizations->get(boxMask) : nullptr;
+                if (cached) {
+                    tbox = -cached->solve(bBox);
+                }
+                else {
+                    Matrix AAtBox = Matrix::Zero(r, r);
+                    for (int j = 0; j < numState[box]; ++j) {
+                        for (int i = 0; i < numState[box]; ++i) {
+                            AAtBox(i, j) = AAt(stateIdx[box](i), stateIdx[box](j));
+                        }
+                    }
+                    tbox = -AAtBox.ldlt().solve(bBox);
+                }
                 /*
                 * check the feasibility for variables
                 * corresponding to the box contraints
@@ -469,7 +880,7 @@ private:
             t = tx;
             tcurr = tnext;
 
-            optCond = grad.binaryExpr(t, ProjGradT(slackEps)).norm();
+            optCond = grad.binaryExpr(t, ProjGradT<Scalar>(slackEps)).norm();
 
             /* finish this iteration */
             ++niter;
@@ -485,14 +896,14 @@ private:
             for (int i = 0; i < r; ++i) {
                 prod = AAt.col(i).dot(t) - b(i);
                 t(i) -= prod / AAt(i, i);
-                t(i) = std::max(0.0, t(i));
-                t(i) = std::min(1.0, t(i));
+                t(i) = std::max(Scalar(0), t(i));
+                t(i) = std::min(Scalar(1), t(i));
 
                 grad += AAt.col(i) * t(i);
             }
 
             /* Evaluate optimality condition */
-            optCond = grad.binaryExpr(t, ProjGradT(slackEps)).norm();
+            optCond = grad.binaryExpr(t, ProjGradT<Scalar>(slackEps)).norm();
 
             /* finish this iteration */
             ++niter;
@@ -500,15 +911,14 @@ private:
     }
 
     void solveNewton(Vector& t) {
-        VectorIdx fidxv = VectorIdx::Zero(r, 1);
-        Vector grad = Vector::Zero(r, 1);
-        Vector descent = Vector::Zero(r, 1);
+        descent.setZero();
         evalGrad(t, grad);
 
-        optCond = grad.binaryExpr(t, ProjGradT(slackEps)).norm();
+        optCond = grad.binaryExpr(t, ProjGradT<Scalar>(slackEps)).norm();
         while (niter <= itersMax && optCond > tol) {
             /* find 'free' and 'restricted' variables */
             int freeVarsNum = 0;
+            unsigned int freeMask = 0;
             for (int i = 0; i < r; ++i) {
                 /* specifying descent for 'restricted' variables */
                 if (t(i) <= slackEps && grad(i) > 0) {
@@ -519,6 +929,7 @@ private:
                 }
                 else {
                     fidxv(freeVarsNum++) = i;
+                    freeMask |= 1u << i;
                 }
             }
 
@@ -529,21 +940,27 @@ private:
             */
             if (!freeVarsNum) break;
 
-            /* compute the corresponding submatrix of the Hessian */
-            Matrix AAtFree = Matrix::Zero(r, r);
-            for (int j = 0; j < freeVarsNum; ++j) {
-                for (int i = 0; i < freeVarsNum; ++i) {
-                    AAtFree(i, j) = AAt(fidxv(i), fidxv(j));
-                }
-            }
-
-            Vector gradFree = Vector::Zero(r, 1);
+            gradFree.setZero();
             for (int i = 0; i < freeVarsNum; ++i) {
                 gradFree(i) = grad(fidxv(i));
             }
 
             /* Descent for 'free' variables */
-            Vector descentFree = -AAtFree.ldlt().solve(gradFree);
+            const Eigen::LDLT<Matrix>* cached =
+                factorizations ? factorizations->get(freeMask) : nullptr;
+            if (cached) {
+                descentFree = -cached->solve(gradFree);
+            }
+            else {
+                /* compute the corresponding submatrix of the Hessian */
+                AAtFree.setZero();
+                for (int j = 0; j < freeVarsNum; ++j) {
+                    for (int i = 0; i < freeVarsNum; ++i) {
+                        AAtFree(i, j) = AAt(fidxv(i), fidxv(j));
+                    }
+                }
+                descentFree = -ldltFree.compute(AAtFree).solve(gradFree);
+            }
             for (int i = 0; i < freeVarsNum; ++i) {
                 descent(fidxv(i)) = descentFree(i);
             }
@@ -552,7 +969,7 @@ private:
             evalGrad(t, grad);
 
             /* Evaluate optimality condition */
-            optCond = std::min(grad.binaryExpr(t, ProjGradT(slackEps)).norm(),
+            optCond = std::min<double>(grad.binaryExpr(t, ProjGradT<Scalar>(slackEps)).norm(),
                     1e+03 * descent.norm());
 
             /* finish this iteration */
@@ -574,7 +991,7 @@ private:
             Scalar alpha = 0.1,
             Scalar beta  = 0.5) {
         Scalar objFtcurr = objF(t);
-        Vector tcurr = t;
+        tcurr = t;
         Vector& tnew = t;
 
         Scalar step = 1.0;
@@ -595,171 +1012,2208 @@ private:
     }
 };
 
-struct SolverSuppOutput {
-    int niters;
-    double objF;
-    double rmse;
-};
+/*
+ * Projected coordinate descent and Newton's method
+ * over blocks of columns of Tt.
+ *
+ * A block is kept transposed (Lanes x DIM), so every coordinate
+ * of all the columns in the block is contiguous and the sweeps,
+ * gradients and objectives are vectorized across the columns
+ * by Eigen's packet math.
+ *
+ * Coordinate descent freezes converged columns with a per-lane mask.
+ * Newton's method keeps a free set per lane, solves the small system
+ * of the free variables lane by lane and lets every lane backtrack
+ * to its own step. Its iteration counts vary much more between the
+ * columns, so a lane whose column is done is refilled
+ * with the next column instead of idling until the block is done.
+ *
+ * Every column goes through the same iterates (up to rounding)
+ * as with QPBoxSolverSmallDims::solveCoordDescent or solveNewton.
+ */
+template <int DIM = 16, typename Scalar = Double>
+class QPBoxBatchSolver {
+public:
+    static const int Lanes = 16;
 
-template <int DIM = -1>
-void applySolver(const RMatrixIn& Dt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
-        double lambda, int itersMax, double tol, double tolA, double tolT,
-        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
-    using MatrixDD = Eigen::Matrix<Double, DIM, DIM>;
-    using VectorDD = Eigen::Matrix<Double, DIM, 1>;
-    using MatrixDX = Eigen::Matrix<Double, DIM, Dynamic>;
+    /* Newton's method is batched for the fixed dimensions only,
+     * below 7 the per-column solver is as fast */
+    static const bool batchedNewton = (DIM != Dynamic && DIM >= 7);
 
-    size_t r = mAinit.rows();
-    size_t n = Dt.rows();
-    size_t m = Dt.cols();
+    using Matrix     = Eigen::Matrix<Scalar, DIM, DIM>;
+    using MatrixX    = Eigen::Matrix<Scalar, DIM, Dynamic>;
+    using BlockArray = Eigen::Array<Scalar, Lanes, DIM>;
+    using LaneArray  = Eigen::Array<Scalar, Lanes, 1>;
+    using LaneMask   = Eigen::Array<bool, Lanes, 1>;
+    using LaneIdx    = Eigen::Array<int, Lanes, 1>;
+    using LaneMasks  = Eigen::Array<unsigned int, Lanes, 1>;
 
-    /* Convert to Eigen's data types */
-    MatrixDX Tt = mTtinit.template cast<Double>();
-    MatrixDX A  = mAinit.template cast<Double>();
+private:
+    const Matrix AAt;
+    double tol;
+    int itersMax;
+    int r;
 
-    /* Time-savers */
-    auto onesrm = MatrixDX::Ones(r, m);
+    const Scalar slackEps = 1e-15;
 
-    //TODO: make it a parameter!!!
-    int innerItersMax = 500;
+    BlockArray T;
+    BlockArray B;
+    BlockArray G;
+    LaneArray tnew;
+    LaneArray optCond;
+    LaneMask active;
+
+    /* Scratch space of the Newton method */
+    BlockArray D;
+    BlockArray Tcurr;
+    BlockArray Tnew;
+    /* Tnew * AAt of the line search and T * AAt */
+    BlockArray TnewAAt;
+    BlockArray TAAt;
+    /* 1 where T is at a bound, 0 elsewhere */
+    BlockArray atZero;
+    BlockArray atOne;
+    LaneMasks freeMasks;
+    LaneIdx cols;
+    LaneIdx laneIter;
+    LaneArray step;
+    LaneArray objCurr;
+    LaneArray objNew;
+    LaneArray slope;
+    LaneMask searching;
+    LaneMask accept;
+    Eigen::LDLT<Matrix> ldltFree;
+    Matrix inverseFree;
+
+    FreeSetFactorizationCache<DIM, Scalar>* factorizations = nullptr;
 
-    int niter = 1;
-    double optCond = 1e+10;
-    int method = QPBoxSolverSmallDims<DIM>::Method::newton;
-    if (2 == r) {
-        method = QPBoxSolverSmallDims<DIM>::Method::exact_rank_2;
-    }
-    else if (14 < r) {
-        method = QPBoxSolverSmallDims<DIM>::Method::coord_descent;
+public:
+    QPBoxBatchSolver(const Matrix& AAt, double tol, int itersMax)
+        : AAt(AAt), tol(tol), itersMax(itersMax), r(AAt.cols()),
+        T(BlockArray::Zero(Lanes, r)), B(BlockArray::Zero(Lanes, r)),
+        G(BlockArray::Zero(Lanes, r))
+    {}
+
+    /* Share factorizations of the Hessian submatrices,
+     * the cache has to be built for the same AAt */
+    inline void setFactorizationCache(FreeSetFactorizationCache<DIM, Scalar>* cache) {
+        factorizations = FreeSetFactorizationCache<DIM, Scalar>::enabled ? cache : nullptr;
     }
 
-    MatrixDX Ttprev;
-    MatrixDX Aprev;
+    /* Coordinate descent for the columns [first, first + count) of Tt,
+     * count <= Lanes, Tt is updated in place.
+     * Returns the iterations summed over the columns */
+    int solve(MatrixX& Tt, const MatrixX& Bt, int first, int count) {
+        T.setZero();
+        B.setZero();
+        T.topRows(count) = Tt.middleCols(first, count).transpose().array().max(0.0).min(1.0);
+        B.topRows(count) = Bt.middleCols(first, count).transpose().array();
+        active.setConstant(false);
+        active.head(count).setConstant(true);
+
+        int niter = 1;
+        int laneIters = 0;
+        while (niter <= itersMax && active.any()) {
+            laneIters += active.count();
+            for (int i = 0; i < r; ++i) {
+                tnew = (T.matrix() * AAt.col(i)).array() - B.col(i);
+                tnew = (T.col(i) - tnew / AAt(i, i)).max(0.0).min(1.0);
+                T.col(i) = active.select(tnew, T.col(i));
+            }
 
-    while (niter <= itersMax && optCond > tol) {
-        Ttprev = Tt;
-        Aprev  = A;
+            /* Evaluate optimality condition */
+            G = (T.matrix() * AAt).array() - B;
+            evalProjGradNorm();
+            active = active && (optCond > tol);
 
-        /*
-        * Optimization wrt A {
-        */
-        ProbSimplexProjector<RMatrixIn, DIM> probSmplxProjector(Dt, Tt, tolA, innerItersMax);
-        probSmplxProjector.solve(A);
+            /* finish this iteration */
+            ++niter;
+        }
 
-        /*
-        * }
-        */
+        Tt.middleCols(first, count) = T.topRows(count).transpose().matrix();
 
-        /*
-        * Optimization wrt T {
-        */
-        MatrixDD AAt = A * A.transpose();
-        MatrixDX B = A * Dt - lambda * (onesrm - 2 * Ttprev);
+        return laneIters;
+    }
 
-        //#pragma omp parallel for schedule(runtime)
-        for (int i = 0; i < m; ++i) {
-            VectorDD t = Tt.col(i);
-            VectorDD b = B.col(i);
-            QPBoxSolverSmallDims<DIM> solver(AAt, b, tolT, innerItersMax);
-            solver.solve(t, method);
-            Tt.col(i) = t;
+    /* Newton's method for the columns [first, first + count) of Tt,
+     * any count, Tt is updated in place.
+     * Returns the iterations summed over the columns */
+    int solveNewton(MatrixX& Tt, const MatrixX& Bt, int first, int count) {
+        const Scalar alpha = 0.1;
+        const Scalar beta  = 0.5;
+
+        allocateNewtonScratch();
+        T.setZero();
+        B.setZero();
+        G.setZero();
+        TAAt.setZero();
+        int next = first;
+        for (int l = 0; l < Lanes; ++l) {
+            refill(l, Tt, Bt, next, first + count);
         }
-        /*
-        * }
-        */
 
-        ++niter;
-        double dA = (Aprev - A).norm() / std::sqrt(r * n);
-        double dT = (Ttprev - Tt).norm() / std::sqrt(r * m);
-        optCond = std::sqrt(dA * dA + dT * dT);
-    }
+        int laneIters = 0;
+        while (active.any()) {
+            /* 'restricted' variables move to their bound,
+             * the descent of the 'free' ones is set per lane.
+             * The loops over the elements of the block are branch-free,
+             * which variables are at a bound is as good as random */
+            freeMasks.setZero();
+            for (int i = 0; i < r; ++i) {
+                for (int l = 0; l < Lanes; ++l) {
+                    const Scalar t = T(l, i);
+                    const Scalar g = G(l, i);
+                    const bool atZero = (t <= slackEps) & (g > 0);
+                    const bool atOne  = (t >= 1 - slackEps) & (g < 0);
+                    D(l, i) = Scalar(atOne) - Scalar(atZero | atOne) * t;
+                    freeMasks(l) |= (unsigned int)!(atZero | atOne) << i;
+                }
+            }
+            for (int l = 0; l < Lanes; ++l) {
+                /* if all variables are restricted, the column is done */
+                if (active(l) && !solveFreeVars(l, freeMasks(l))) {
+                    active(l) = false;
+                    D.row(l).setZero();
+                }
+            }
+            laneIters += active.count();
+
+            /* Backtracking line search, every lane accepts its own step.
+             * Lanes that are not active have D = 0 and stay put */
+            Tcurr = T;
+            objCurr = (T * (Scalar(0.5) * (G - B))).rowwise().sum();
+            step.setOnes();
+            searching = active;
+            for (bool fullStep = true; searching.any(); fullStep = false) {
+                Tnew = (Tcurr + D.colwise() * step).min(Scalar(1)).max(Scalar(0));
+                mulAAt(Tnew, TnewAAt);
+                objNew = ((Scalar(0.5) * TnewAAt - B) * Tnew).rowwise().sum();
+                slope = (G * (Tnew - Tcurr)).rowwise().sum();
+                bool all = true;
+                for (int l = 0; l < Lanes; ++l) {
+                    accept(l) = searching(l)
+                        && !(objNew(l) > objCurr(l) + alpha * step(l) * slope(l));
+                    all = all && accept(l) == searching(l);
+                }
+                if (fullStep && all) {
+                    /* the common case, every lane takes the full step */
+                    T.swap(Tnew);
+                    TAAt.swap(TnewAAt);
+                    break;
+                }
+                for (int l = 0; l < Lanes; ++l) {
+                    if (accept(l)) {
+                        T.row(l)    = Tnew.row(l);
+                        TAAt.row(l) = TnewAAt.row(l);
+                        searching(l) = false;
+                    }
+                    else if (searching(l)) {
+                        step(l) *= beta;
+                    }
+                }
+            }
+            G = TAAt - B;
 
-    /*
-     * Forming output
-     */
-    mTtout  = Tt;
-    mAout   = A;
-    supp.niters = niter - 1;
-    supp.rmse   = 0.5 * (Dt - A.transpose() * Tt).squaredNorm();
-    supp.objF   = supp.rmse + lambda * (Tt.sum() - Tt.squaredNorm());
-    supp.rmse  /= m;
-    supp.rmse  /= n;
-}
+            /* Evaluate optimality condition, ProjGradT without branches */
+            for (int i = 0; i < r; ++i) {
+                for (int l = 0; l < Lanes; ++l) {
+                    atZero(l, i) = T(l, i) <= slackEps;
+                    atOne(l, i)  = T(l, i) >= 1 - slackEps;
+                }
+            }
+            objNew = (G - atZero * G.max(Scalar(0)) - atOne * G.min(Scalar(0)))
+                .square().rowwise().sum();
+            slope = D.square().rowwise().sum();
+            for (int l = 0; l < Lanes; ++l) {
+                if (active(l)) {
+                    optCond(l) = std::min(std::sqrt(objNew(l)), Scalar(1e+03) * std::sqrt(slope(l)));
+                    ++laneIter(l);
+                    active(l) = optCond(l) > tol && laneIter(l) <= itersMax;
+                }
+            }
 
-/* Some Voodoo magic to eliminate
- * long switches for different dimensions */
-template <int ...> struct DimList {};
+            /* done columns make room for the next ones */
+            for (int l = 0; l < Lanes; ++l) {
+                if (!active(l) && cols(l) >= 0) {
+                    Tt.col(cols(l)) = T.row(l).transpose().matrix();
+                    refill(l, Tt, Bt, next, first + count);
+                }
+            }
+        }
 
-/* border case */
-void solve(int d, const RMatrixIn& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
-        double lambda, int itersMax, double tol, double tolA, double tolT,
-        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp,
-        DimList<>) {
-}
+        return laneIters;
+    }
 
-template <int DIM, int ...DIMS>
-void solve(int d, const RMatrixIn& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
-        double lambda, int itersMax, double tol, double tolA, double tolT,
-        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp,
-        DimList<DIM, DIMS...>) {
-    if (DIM != d) {
-        return solve(d, mDt, mTtinit, mAinit, lambda,
-                itersMax, tol, tolA, tolT,
-                mTtout, mAout, supp,
-                DimList<DIMS...>());
+private:
+    void allocateNewtonScratch() {
+        if (D.cols() == r) {
+            return;
+        }
+        D           = BlockArray::Zero(Lanes, r);
+        Tcurr       = BlockArray::Zero(Lanes, r);
+        Tnew        = BlockArray::Zero(Lanes, r);
+        TnewAAt     = BlockArray::Zero(Lanes, r);
+        TAAt        = BlockArray::Zero(Lanes, r);
+        atZero      = BlockArray::Zero(Lanes, r);
+        atOne       = BlockArray::Zero(Lanes, r);
+        ldltFree    = Eigen::LDLT<Matrix>(r);
+        inverseFree = Matrix::Zero(r, r);
     }
 
-    applySolver<DIM>(mDt, mTtinit, mAinit, lambda,
-            itersMax, tol, tolA, tolT,
-            mTtout, mAout, supp);
-}
+    /* Loads the next column that is not optimal already into lane l,
+     * the optimal ones are only clamped to the box. Empties the lane
+     * if there are no columns left */
+    void refill(int l, MatrixX& Tt, const MatrixX& Bt, int& next, int end) {
+        while (next < end) {
+            const int i = next++;
+            T.row(l)    = Tt.col(i).transpose().array().max(0.0).min(1.0);
+            B.row(l)    = Bt.col(i).transpose().array();
+            TAAt.row(l) = T.row(l).matrix() * AAt;
+            G.row(l)    = TAAt.row(l) - B.row(l);
+            if (itersMax >= 1 && G.row(l).binaryExpr(T.row(l),
+                        ProjGradT<Scalar>(slackEps)).matrix().norm() > tol) {
+                cols(l)     = i;
+                laneIter(l) = 1;
+                active(l)   = true;
+                return;
+            }
+            Tt.col(i) = T.row(l).transpose().matrix();
+        }
 
-template <int ...DIMS>
-void solve(int d, const RMatrixIn& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
-        double lambda, int itersMax, double tol, double tolA, double tolT,
-        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
-        solve(d, mDt, mTtinit, mAinit, lambda,
-                itersMax, tol, tolA, tolT,
-                mTtout, mAout, supp,
-                DimList<DIMS...>());
-}
+        cols(l)   = -1;
+        active(l) = false;
+        T.row(l).setZero();
+        B.row(l).setZero();
+        G.row(l).setZero();
+        TAAt.row(l).setZero();
+    }
 
-// [[Rcpp::export]]
-RcppExport SEXP cppTAfact(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP,
-        double lambda = 0.0, int itersMax = 1000,
-        double tol = 1e-8, double tolA = 1e-7, double tolT = 1e-7) {
-    /* Prepare Eigen for multithreading */
-    Eigen::initParallel();
-    Eigen::setNbThreads(1);
+    /* Adds the Newton step of the free variables in freeMask
+     * of lane l to D, false if there are none */
+    bool solveFreeVars(int l, unsigned int freeMask) {
+        if (!freeMask) {
+            return false;
+        }
+
+        /* The inverse is zero outside of the free variables.
+         * A miss in a full cache factors it the same way, so the step
+         * does not depend on which thread filled the cache first */
+        const Matrix* inverse = factorizations ? factorizations->getInverse(freeMask) : nullptr;
+        if (!inverse) {
+            FreeSetFactorizationCache<DIM, Scalar>::factorSubmatrix(AAt, freeMask,
+                    ldltFree, inverseFree);
+            inverse = &inverseFree;
+        }
+        D.row(l) -= (G.row(l).matrix() * *inverse).array();
+
+        return true;
+    }
+
+    /* XA = X * AAt as r^2 column updates,
+     * Eigen's product kernels do much worse on a Lanes x r block */
+    inline void mulAAt(const BlockArray& X, BlockArray& XA) const {
+        for (int j = 0; j < r; ++j) {
+            XA.col(j) = X.col(0) * AAt(0, j);
+            for (int i = 1; i < r; ++i) {
+                XA.col(j) += X.col(i) * AAt(i, j);
+            }
+        }
+    }
+
+    /* Norm of the projected gradient of every lane, see ProjGradT */
+    inline void evalProjGradNorm() {
+        optCond = (T <= slackEps).select(G.min(0.0),
+                (T < Scalar(1.0 - slackEps)).select(G, G.max(0.0)))
+            .square().rowwise().sum().sqrt();
+    }
+};
+
+/*
+ * The data matrix Dt (n x m) as seen by the solver.
+ *
+ * An alternation needs Dt only through two products,
+ * A * Dt for the T-step and Tt * Dt^T for the A-step,
+ * (plus the residual at the end), so how Dt is stored
+ * is up to the implementations.
+ *
+ * Sources are set up and read outside of R (e.g. by the runs of
+ * cppTAfactMulti), so they report errors as std::runtime_error,
+ * the exported functions turn them into R errors.
+ * Tt is not part of the source, it is held in memory by the solver.
+ */
+template <typename Scalar = Double>
+class DataSource {
+public:
+    using MatrixX = Eigen::Matrix<Scalar, Dynamic, Dynamic>;
+
+    virtual ~DataSource() {}
+
+    virtual Eigen::Index rows() const = 0;
+    virtual Eigen::Index cols() const = 0;
+
+    /* out += L * Dt, L is k x n */
+    virtual void leftMulAdd(const Eigen::Ref<const MatrixX>& L,
+            Eigen::Ref<MatrixX> out) const = 0;
+
+    /* out = R * Dt^T, R is k x m */
+    virtual void rightMulT(const Eigen::Ref<const MatrixX>& R,
+            Eigen::Ref<MatrixX> out) const = 0;
+
+    /* Size of a stored entry, a pass over Dt reads rows() * cols() of them */
+    virtual size_t elementBytes() const = 0;
+
+    /*
+     * Out-of-core sources are read in blocks of CpGs,
+     * the solver then makes one pass over the blocks per alternation.
+     */
+    virtual bool streaming() const {
+        return false;
+    }
+
+    /*
+     * CpGs processed together by the passes over Dt:
+     * about 4 MiB of Dt, and at least 4096 of them.
+     * Out-of-core sources use their blocks.
+     */
+    virtual Eigen::Index tileCols() const {
+        const Eigen::Index colBytes = std::max<Eigen::Index>(rows(), 1) * elementBytes();
+        return std::min<Eigen::Index>(std::max<Eigen::Index>(cols(), 1),
+                std::max<Eigen::Index>(4096, (4 << 20) / colBytes));
+    }
+
+    /* Columns [first, first + count) of Dt, stored as count x n */
+    virtual void readBlock(Eigen::Index first, Eigen::Index count, MatrixX& block) const {
+        throw std::runtime_error("the data source does not support block reads");
+    }
+
+    /* out += L * Dt[, first:(first + count)], out is k x count */
+    virtual void leftMulAddCols(const Eigen::Ref<const MatrixX>& L, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        MatrixX block;
+        readBlock(first, count, block);
+        out.noalias() += L * block.transpose();
+    }
+
+    /* out += R * Dt[, first:(first + count)]^T, R is k x count */
+    virtual void rightMulTAddCols(const Eigen::Ref<const MatrixX>& R, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        MatrixX block;
+        readBlock(first, count, block);
+        out.noalias() += R * block;
+    }
+
+    /* The same in double whatever Scalar is, for sums that must keep their digits */
+    virtual void rightMulTAddColsDouble(const Eigen::Ref<const Eigen::MatrixXd>& R,
+            Eigen::Index first, Eigen::Index count, Eigen::Ref<Eigen::MatrixXd> out) const {
+        MatrixX block;
+        readBlock(first, count, block);
+        out.noalias() += R * block.template cast<double>();
+    }
+
+    /* || Dt - A^T * Tt ||^2 over columns [first, first + count), res is a buffer.
+     * The squares are summed in double */
+    virtual double squaredResidualCols(const Eigen::Ref<const MatrixX>& A,
+            const Eigen::Ref<const MatrixX>& Tt, Eigen::Index first, Eigen::Index count,
+            MatrixX& res) const {
+        readBlock(first, count, res);
+        res.noalias() -= Tt.middleCols(first, count).transpose() * A;
+        return res.template cast<double>().squaredNorm();
+    }
+
+    /*
+     * || Dt - A^T * Tt ||^2, evaluated tile by tile,
+     * a thread holds the residual of one tile at a time.
+     * The sums of the tiles are added in order,
+     * so the value does not depend on nthreads.
+     */
+    double squaredResidual(const Eigen::Ref<const MatrixX>& A,
+            const Eigen::Ref<const MatrixX>& Tt, int nthreads = 1) const {
+        const Eigen::Index m = cols();
+        const Eigen::Index tile = tileCols();
+        const int ntiles = (m + tile - 1) / tile;
+        std::vector<double> sums(ntiles);
+
+        /* reads of out-of-core sources may fail, they stay on this thread */
+        if (streaming() || nthreads <= 1) {
+            MatrixX res;
+            for (int t = 0; t < ntiles; ++t) {
+                sums[t] = squaredResidualCols(A, Tt, t * tile, std::min(tile, m - t * tile), res);
+            }
+        }
+        else {
+            #pragma omp parallel num_threads(nthreads)
+            {
+                MatrixX res;
+
+                #pragma omp for schedule(dynamic)
+                for (int t = 0; t < ntiles; ++t) {
+                    sums[t] = squaredResidualCols(A, Tt, t * tile,
+                            std::min(tile, m - t * tile), res);
+                }
+            }
+        }
+
+        double total = 0.0;
+        for (int t = 0; t < ntiles; ++t) {
+            total += sums[t];
+        }
+
+        return total;
+    }
+};
+
+/*
+ * Dt held in memory as a column-major n x m array of Storage.
+ *
+ * When Storage is narrower than Scalar (float data, double computations)
+ * Dt is widened panel by panel, so the products read half the bytes
+ * and still accumulate in Scalar.
+ */
+template <typename Scalar = Double, typename Storage = Scalar>
+class DenseDataSource : public DataSource<Scalar> {
+public:
+    using MatrixX = typename DataSource<Scalar>::MatrixX;
+    using StorageMatrix = Eigen::Matrix<Storage, Dynamic, Dynamic>;
+
+private:
+    Map<const StorageMatrix> Dt;
+    Eigen::Index panelCols;
+
+public:
+    DenseDataSource(const Storage* data, Eigen::Index n, Eigen::Index m)
+        : Dt(data, n, m),
+        panelCols(std::is_same<Scalar, Storage>::value ? std::max<Eigen::Index>(m, 1) : 2048)
+    {}
+
+    Eigen::Index rows() const {
+        return Dt.rows();
+    }
+
+    Eigen::Index cols() const {
+        return Dt.cols();
+    }
+
+    size_t elementBytes() const {
+        return sizeof(Storage);
+    }
+
+    void leftMulAdd(const Eigen::Ref<const MatrixX>& L, Eigen::Ref<MatrixX> out) const {
+        for (Eigen::Index j = 0; j < Dt.cols(); j += panelCols) {
+            Eigen::Index w = std::min(panelCols, Dt.cols() - j);
+            out.middleCols(j, w).noalias() += L * Dt.middleCols(j, w).template cast<Scalar>();
+        }
+    }
+
+    void rightMulT(const Eigen::Ref<const MatrixX>& R, Eigen::Ref<MatrixX> out) const {
+        out.setZero();
+        for (Eigen::Index j = 0; j < Dt.cols(); j += panelCols) {
+            Eigen::Index w = std::min(panelCols, Dt.cols() - j);
+            out.noalias() += R.middleCols(j, w)
+                * Dt.middleCols(j, w).template cast<Scalar>().transpose();
+        }
+    }
+
+    void leftMulAddCols(const Eigen::Ref<const MatrixX>& L, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        out.noalias() += L * Dt.middleCols(first, count).template cast<Scalar>();
+    }
+
+    void rightMulTAddCols(const Eigen::Ref<const MatrixX>& R, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        out.noalias() += R * Dt.middleCols(first, count).template cast<Scalar>().transpose();
+    }
+
+    void rightMulTAddColsDouble(const Eigen::Ref<const Eigen::MatrixXd>& R,
+            Eigen::Index first, Eigen::Index count, Eigen::Ref<Eigen::MatrixXd> out) const {
+        out.noalias() += R * Dt.middleCols(first, count).template cast<double>().transpose();
+    }
+
+    double squaredResidualCols(const Eigen::Ref<const MatrixX>& A,
+            const Eigen::Ref<const MatrixX>& Tt, Eigen::Index first, Eigen::Index count,
+            MatrixX& res) const {
+        res.noalias() = A.transpose() * Tt.middleCols(first, count);
+        res -= Dt.middleCols(first, count).template cast<Scalar>();
+        return res.template cast<double>().squaredNorm();
+    }
+};
+
+/*
+ * D (m x n) laid out as R stores it, which is Dt in row-major order.
+ * Serves data that is not transposed into a separate matrix,
+ * such as a memory-mapped file, panels are taken over the rows of D.
+ */
+template <typename Scalar = Double, typename Storage = Scalar>
+class TransposedDataSource : public DataSource<Scalar> {
+public:
+    using MatrixX = typename DataSource<Scalar>::MatrixX;
+    using StorageMatrix = Eigen::Matrix<Storage, Dynamic, Dynamic>;
+
+private:
+    Map<const StorageMatrix> D;
+    Eigen::Index panelRows;
+
+public:
+    TransposedDataSource(const Storage* data, Eigen::Index n, Eigen::Index m)
+        : D(data, m, n),
+        panelRows(std::is_same<Scalar, Storage>::value ? std::max<Eigen::Index>(m, 1) : 2048)
+    {}
+
+    Eigen::Index rows() const {
+        return D.cols();
+    }
+
+    Eigen::Index cols() const {
+        return D.rows();
+    }
+
+    size_t elementBytes() const {
+        return sizeof(Storage);
+    }
+
+    void leftMulAdd(const Eigen::Ref<const MatrixX>& L, Eigen::Ref<MatrixX> out) const {
+        for (Eigen::Index j = 0; j < D.rows(); j += panelRows) {
+            Eigen::Index w = std::min(panelRows, D.rows() - j);
+            out.middleCols(j, w).noalias() += L
+                * D.middleRows(j, w).template cast<Scalar>().transpose();
+        }
+    }
+
+    void rightMulT(const Eigen::Ref<const MatrixX>& R, Eigen::Ref<MatrixX> out) const {
+        out.setZero();
+        for (Eigen::Index j = 0; j < D.rows(); j += panelRows) {
+            Eigen::Index w = std::min(panelRows, D.rows() - j);
+            out.noalias() += R.middleCols(j, w) * D.middleRows(j, w).template cast<Scalar>();
+        }
+    }
+
+    void leftMulAddCols(const Eigen::Ref<const MatrixX>& L, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        out.noalias() += L * D.middleRows(first, count).template cast<Scalar>().transpose();
+    }
+
+    void rightMulTAddCols(const Eigen::Ref<const MatrixX>& R, Eigen::Index first,
+            Eigen::Index count, Eigen::Ref<MatrixX> out) const {
+        out.noalias() += R * D.middleRows(first, count).template cast<Scalar>();
+    }
+
+    void rightMulTAddColsDouble(const Eigen::Ref<const Eigen::MatrixXd>& R,
+            Eigen::Index first, Eigen::Index count, Eigen::Ref<Eigen::MatrixXd> out) const {
+        out.noalias() += R * D.middleRows(first, count).template cast<double>();
+    }
+
+    double squaredResidualCols(const Eigen::Ref<const MatrixX>& A,
+            const Eigen::Ref<const MatrixX>& Tt, Eigen::Index first, Eigen::Index count,
+            MatrixX& res) const {
+        res.noalias() = Tt.middleCols(first, count).transpose() * A;
+        res -= D.middleRows(first, count).template cast<Scalar>();
+        return res.template cast<double>().squaredNorm();
+    }
+};
+
+/*
+ * Read-only mapping of a whole file.
+ * Pages come from the page cache and are shared
+ * by all the processes mapping the same file.
+ */
+class MappedFile {
+    void* addr;
+    size_t length;
+
+public:
+    explicit MappedFile(const std::string& path) : addr(nullptr), length(0) {
+#ifdef _WIN32
+        throw std::runtime_error("memory-mapped input is not supported on this platform");
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open '" + path + "'");
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            throw std::runtime_error("cannot map '" + path + "': empty or unreadable file");
+        }
+        length = st.st_size;
+
+        addr = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (MAP_FAILED == addr) {
+            addr = nullptr;
+            throw std::runtime_error("cannot map '" + path + "'");
+        }
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (addr) {
+            munmap(addr, length);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    inline const void* data() const {
+        return addr;
+    }
+
+    inline size_t size() const {
+        return length;
+    }
+};
+
+/*
+ * D (m x n) in a file as raw column-major Storage, read with pread()
+ * one block of CpGs at a time. Only the current block is held in memory,
+ * reads of different threads do not interfere.
+ */
+template <typename Scalar = Double, typename Storage = Scalar>
+class StreamingDataSource : public DataSource<Scalar> {
+public:
+    using MatrixX = typename DataSource<Scalar>::MatrixX;
+    using StorageMatrix = Eigen::Matrix<Storage, Dynamic, Dynamic>;
+
+private:
+    std::string path;
+    int fd;
+    Eigen::Index n;
+    Eigen::Index m;
+    Eigen::Index blockSize;
+
+public:
+    StreamingDataSource(const std::string& path, Eigen::Index n, Eigen::Index m,
+            Eigen::Index blockSize)
+        : path(path), fd(-1), n(n), m(m),
+        blockSize(std::max<Eigen::Index>(std::min(blockSize, m), 1))
+    {
+#ifdef _WIN32
+        throw std::runtime_error("streaming input is not supported on this platform");
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("cannot open '" + path + "'");
+        }
+#endif
+    }
+
+    ~StreamingDataSource() {
+#ifndef _WIN32
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+
+    StreamingDataSource(const StreamingDataSource&) = delete;
+    StreamingDataSource& operator=(const StreamingDataSource&) = delete;
+
+    Eigen::Index rows() const {
+        return n;
+    }
+
+    Eigen::Index cols() const {
+        return m;
+    }
+
+    size_t elementBytes() const {
+        return sizeof(Storage);
+    }
+
+    bool streaming() const {
+        return true;
+    }
+
+    Eigen::Index tileCols() const {
+        return blockSize;
+    }
+
+    void readBlock(Eigen::Index first, Eigen::Index count, MatrixX& block) const {
+        StorageMatrix raw(count, n);
+#ifndef _WIN32
+        /* a block of rows of D is a strided read, one pread per sample */
+        for (Eigen::Index c = 0; c < n; ++c) {
+            char* dst = reinterpret_cast<char*>(raw.col(c).data());
+            size_t left = count * sizeof(Storage);
+            off_t offset = (c * m + first) * sizeof(Storage);
+            while (left > 0) {
+                ssize_t got = pread(fd, dst, left, offset);
+                if (got <= 0) {
+                    throw std::runtime_error("cannot read '" + path + "'");
+                }
+                dst    += got;
+                left   -= got;
+                offset += got;
+            }
+        }
+#endif
+        block = raw.template cast<Scalar>();
+    }
+
+    void leftMulAdd(const Eigen::Ref<const MatrixX>& L, Eigen::Ref<MatrixX> out) const {
+        MatrixX block;
+        for (Eigen::Index j = 0; j < m; j += blockSize) {
+            Eigen::Index w = std::min(blockSize, m - j);
+            readBlock(j, w, block);
+            out.middleCols(j, w).noalias() += L * block.transpose();
+        }
+    }
+
+    void rightMulT(const Eigen::Ref<const MatrixX>& R, Eigen::Ref<MatrixX> out) const {
+        MatrixX block;
+        out.setZero();
+        for (Eigen::Index j = 0; j < m; j += blockSize) {
+            Eigen::Index w = std::min(blockSize, m - j);
+            readBlock(j, w, block);
+            out.noalias() += R.middleCols(j, w) * block;
+        }
+    }
+
+};
+
+/* Run-time options of the solver */
+struct SolverControl {
+    /* File to save the state to, empty for none.
+     * It only outlives an interrupted run, a finished run removes it */
+    std::string checkpoint;
+    /* Save every checkpointEvery alternations (and on cancellation) */
+    int checkpointEvery = 0;
+    /* Start from the state in checkpoint if the file exists */
+    bool resume = false;
+    /* Collect SolverProfile */
+    bool profile = false;
+    /* JSON-lines file the trace is appended to while running, empty for none */
+    std::string traceFile;
+    /* Identifies the run in traceFile */
+    std::string traceLabel;
+    /* The last fixedRows rows of Tt are known components (Tfix),
+     * they take part in the A-step but are never updated */
+    int fixedRows = 0;
+    /* Flags of the CpGs (columns of Tt, m of them) and the samples
+     * (columns of A, n of them) with known values (Tpartial, Apartial),
+     * empty for none. They keep their initial values,
+     * the T-step and the A-step skip them. */
+    std::vector<char> pinnedCpGs;
+    std::vector<char> pinnedSamples;
+    /* Per-component bounds of A (qp.Alower, qp.Aupper),
+     * r of each or empty for the plain probability simplex */
+    std::vector<double> lowerA;
+    std::vector<double> upperA;
+};
+
+/* Per-alternation history of a run */
+struct SolverTrace {
+    std::vector<double> objF;
+    /* RMS change of A and T */
+    std::vector<double> dA;
+    std::vector<double> dT;
+    /* seconds since the start of the run */
+    std::vector<double> elapsed;
+};
+
+/*
+ * Where the time of a run goes. Phases are wall-clock seconds,
+ * with streaming data forming B and the T-step alternate
+ * block by block and are summed over the blocks.
+ */
+struct SolverProfile {
+    /* Tt * Dt^T, Tt * Tt^T and the FISTA iterations */
+    double aStepTime = 0.0;
+    /* AAt and B = A * Dt - lambda * (1 - 2 * Tt) */
+    double formTime = 0.0;
+    /* screening and the per-column QPs */
+    double tStepTime = 0.0;
+    double residualTime = 0.0;
+    double totalTime = 0.0;
+
+    /* the QP method of the T-step */
+    std::string tStepMethod;
+
+    long aStepIters = 0;
+    /* columns of A projected onto the simplex */
+    long projections = 0;
+    /* columns of Tt handed to the QP solver and their iterations */
+    long tStepColumns = 0;
+    long tStepIters = 0;
+    long screened = 0;
+    /* full passes over Dt */
+    long dataPasses = 0;
+};
+
+/* Seconds since the previous lap */
+class Stopwatch {
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point last;
+
+public:
+    Stopwatch() : last(Clock::now()) {}
+
+    double lap() {
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - last).count();
+        last = now;
+        return elapsed;
+    }
+
+    /* Seconds since the previous lap, without starting a new one */
+    double elapsed() const {
+        return std::chrono::duration<double>(Clock::now() - last).count();
+    }
+};
+
+struct SolverSuppOutput {
+    int niters;
+    double objF;
+    double rmse;
+    /* T-step columns skipped by screening, per alternation */
+    std::vector<int> skipped;
+    /* stopped by a signal before convergence */
+    bool interrupted = false;
+    bool checkpointFailed = false;
+    /* filled when SolverControl::profile is set */
+    SolverProfile profile;
+    SolverTrace trace;
+};
+
+/*
+ * Checkpoint files: a header identifying the problem,
+ * the number of completed alternations and the optimality measure
+ * after the last of them, then A and Tt as doubles
+ * in column-major order.
+ *
+ * The problem is identified by the dimensions, lambda, the number
+ * of known components, digests of the pinned CpGs and samples
+ * and the bounds of A (as many as there are components, or none).
+ */
+static const char checkpointMagic[8] = {'M', 'D', 'C', 'C', 'K', 'P', 'T', '3'};
+
+/* FNV-1a of the flags of pinned columns, 0 if there are none */
+uint64_t pinnedDigest(const std::vector<char>& flags) {
+    if (flags.empty()) {
+        return 0;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    for (char f : flags) {
+        h ^= (unsigned char)f;
+        h *= 1099511628211ULL;
+    }
+
+    return h;
+}
+
+/* The part of the header that depends on SolverControl */
+struct CheckpointProblem {
+    int32_t fixedRows;
+    uint64_t pinnedCpGs;
+    uint64_t pinnedSamples;
+    int64_t nbounds;
+
+    CheckpointProblem() : fixedRows(0), pinnedCpGs(0), pinnedSamples(0), nbounds(0) {}
+
+    explicit CheckpointProblem(const SolverControl& ctrl)
+        : fixedRows(ctrl.fixedRows), pinnedCpGs(pinnedDigest(ctrl.pinnedCpGs)),
+        pinnedSamples(pinnedDigest(ctrl.pinnedSamples)), nbounds(ctrl.lowerA.size())
+    {}
+};
+
+/* Written to a temporary file first and renamed over the old one,
+ * so an interruption never leaves a truncated checkpoint */
+template <typename MatrixA, typename MatrixT>
+bool writeCheckpoint(const std::string& path, const SolverControl& ctrl, int niters,
+        double optCond, double lambda, const MatrixA& A, const MatrixT& Tt) {
+    const RMatrixOut Ad  = A.template cast<double>();
+    const RMatrixOut Ttd = Tt.template cast<double>();
+    const int64_t dims[3] = {(int64_t)Ad.rows(), (int64_t)Ad.cols(), (int64_t)Ttd.cols()};
+    const CheckpointProblem problem(ctrl);
+    const int32_t done = niters;
+
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(checkpointMagic, sizeof(checkpointMagic));
+        out.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+        out.write(reinterpret_cast<const char*>(&lambda), sizeof(lambda));
+        out.write(reinterpret_cast<const char*>(&problem.fixedRows), sizeof(problem.fixedRows));
+        out.write(reinterpret_cast<const char*>(&problem.pinnedCpGs), sizeof(problem.pinnedCpGs));
+        out.write(reinterpret_cast<const char*>(&problem.pinnedSamples),
+                sizeof(problem.pinnedSamples));
+        out.write(reinterpret_cast<const char*>(&problem.nbounds), sizeof(problem.nbounds));
+        out.write(reinterpret_cast<const char*>(ctrl.lowerA.data()),
+                ctrl.lowerA.size() * sizeof(double));
+        out.write(reinterpret_cast<const char*>(ctrl.upperA.data()),
+                ctrl.upperA.size() * sizeof(double));
+        out.write(reinterpret_cast<const char*>(&done), sizeof(done));
+        out.write(reinterpret_cast<const char*>(&optCond), sizeof(optCond));
+        out.write(reinterpret_cast<const char*>(Ad.data()), Ad.size() * sizeof(double));
+        out.write(reinterpret_cast<const char*>(Ttd.data()), Ttd.size() * sizeof(double));
+        out.flush();
+        if (!out) {
+            std::remove(tmp.c_str());
+            return false;
+        }
+    }
+
+    return 0 == std::rename(tmp.c_str(), path.c_str());
+}
+
+/* Returns false if there is no checkpoint to resume from */
+bool readCheckpoint(const std::string& path, const SolverControl& ctrl, double lambda,
+        RMatrixOut& A, RMatrixOut& Tt, int& niters, double& optCond) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    const CheckpointProblem problem(ctrl);
+    char magic[sizeof(checkpointMagic)];
+    int64_t dims[3];
+    double savedLambda;
+    CheckpointProblem saved;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(dims), sizeof(dims));
+    in.read(reinterpret_cast<char*>(&savedLambda), sizeof(savedLambda));
+    in.read(reinterpret_cast<char*>(&saved.fixedRows), sizeof(saved.fixedRows));
+    in.read(reinterpret_cast<char*>(&saved.pinnedCpGs), sizeof(saved.pinnedCpGs));
+    in.read(reinterpret_cast<char*>(&saved.pinnedSamples), sizeof(saved.pinnedSamples));
+    in.read(reinterpret_cast<char*>(&saved.nbounds), sizeof(saved.nbounds));
+    if (!in || !std::equal(magic, magic + sizeof(magic), checkpointMagic)) {
+        throw std::runtime_error("'" + path + "' is not a checkpoint file");
+    }
+
+    bool same = dims[0] == A.rows() && dims[1] == A.cols() && dims[2] == Tt.cols()
+        && savedLambda == lambda && saved.fixedRows == problem.fixedRows
+        && saved.pinnedCpGs == problem.pinnedCpGs
+        && saved.pinnedSamples == problem.pinnedSamples
+        && saved.nbounds == problem.nbounds;
+    if (same && saved.nbounds > 0) {
+        std::vector<double> lower(saved.nbounds), upper(saved.nbounds);
+        in.read(reinterpret_cast<char*>(lower.data()), lower.size() * sizeof(double));
+        in.read(reinterpret_cast<char*>(upper.data()), upper.size() * sizeof(double));
+        same = in && lower == ctrl.lowerA && upper == ctrl.upperA;
+    }
+    if (!same) {
+        throw std::runtime_error("checkpoint '" + path + "' belongs to a different problem");
+    }
+
+    int32_t done;
+    double savedOptCond;
+    in.read(reinterpret_cast<char*>(&done), sizeof(done));
+    in.read(reinterpret_cast<char*>(&savedOptCond), sizeof(savedOptCond));
+
+    in.read(reinterpret_cast<char*>(A.data()), A.size() * sizeof(double));
+    in.read(reinterpret_cast<char*>(Tt.data()), Tt.size() * sizeof(double));
+    if (!in) {
+        throw std::runtime_error("checkpoint '" + path + "' is truncated");
+    }
+    niters = done;
+    optCond = savedOptCond;
+
+    return true;
+}
+
+/*
+ * Appends one JSON object per alternation to a file,
+ * every line goes out in a single flushed write, so the file
+ * can be followed while running and shared by several processes.
+ * Non-finite numbers of a diverging run are written as null.
+ */
+class TraceWriter {
+    std::ofstream out;
+    std::string prefix;
+
+public:
+    TraceWriter(const std::string& path, const std::string& label, double lambda)
+        : out(path.c_str(), std::ios::app)
+    {
+        if (!out) {
+            throw std::runtime_error("cannot open trace file '" + path + "'");
+        }
+
+        std::string escaped;
+        for (char c : label) {
+            if ('"' == c || '\\' == c) {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if ('\n' == c) {
+                escaped += "\\n";
+            }
+            else if ('\t' == c) {
+                escaped += "\\t";
+            }
+            else if ((unsigned char)c < 0x20) {
+                char code[8];
+                snprintf(code, sizeof(code), "\\u%04x", (unsigned int)c);
+                escaped += code;
+            }
+            else {
+                escaped += c;
+            }
+        }
+
+        char head[64];
+        snprintf(head, sizeof(head), "{\"pid\":%ld,", (long)getpid());
+        prefix = head + std::string("\"lambda\":") + number(lambda)
+            + ",\"label\":\"" + escaped + "\",";
+    }
+
+    void write(int niter, double objF, double dA, double dT, double elapsed) {
+        char head[64];
+        char tail[64];
+        snprintf(head, sizeof(head), "\"iter\":%d,", niter);
+        snprintf(tail, sizeof(tail), "\"elapsed\":%.6f}\n", elapsed);
+        out << prefix + head + "\"objF\":" + number(objF) + ",\"dA\":" + number(dA)
+            + ",\"dT\":" + number(dT) + "," + tail;
+        out.flush();
+    }
+
+private:
+    /* JSON has no nan or inf */
+    static std::string number(double x) {
+        if (!std::isfinite(x)) {
+            return "null";
+        }
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.17g", x);
+        return buf;
+    }
+};
+
+/* sum(Tt * (1 - Tt)) over the first k rows of Tt, summed in double */
+template <typename MatrixT>
+double binaryPenalty(const MatrixT& Tt, int k) {
+    return (Tt.topRows(k).template cast<double>().array()
+            * (1.0 - Tt.topRows(k).template cast<double>().array())).sum();
+}
+
+/* Buffers of solveTStep, kept across the alternations of a run */
+template <int DIM = -1, typename Scalar = Double>
+struct TStepWorkspace {
+    std::vector<char> settled;
+    std::vector<int> active;
+    /* active columns gathered for the batched solver, r x m */
+    Eigen::Matrix<Scalar, DIM, Dynamic> Tact;
+    Eigen::Matrix<Scalar, DIM, Dynamic> Bact;
+
+    explicit TStepWorkspace(int m) : settled(m) {
+        active.reserve(m);
+    }
+};
+
+/*
+ * The T-step: every column of Tt solves a box QP
+ * with the Hessian AAt and the corresponding column of B.
+ *
+ * Columns are screened first: a column already in the box whose
+ * projected gradient at the new AAt and B is within tolT satisfies
+ * the optimality conditions the solvers stop at and is skipped.
+ * Columns flagged in pinned are skipped as well, unscreened.
+ * Returns the number of screened out columns.
+ */
+template <int DIM = -1, typename Scalar = Double>
+int solveTStep(const Eigen::Matrix<Scalar, DIM, DIM>& AAt,
+        const Eigen::Matrix<Scalar, DIM, Dynamic>& B, Eigen::Matrix<Scalar, DIM, Dynamic>& Tt,
+        int method, double tolT, int innerItersMax, int nthreads,
+        FreeSetFactorizationCache<DIM, Scalar>& factorizations,
+        TStepWorkspace<DIM, Scalar>& ws, SolverProfile* profile = nullptr,
+        const char* pinned = nullptr) {
+    using VectorDD = Eigen::Matrix<Scalar, DIM, 1>;
+    using MatrixDX = Eigen::Matrix<Scalar, DIM, Dynamic>;
+    using QPSolver = QPBoxSolverSmallDims<DIM, Scalar>;
+    using QPBatchSolver = QPBoxBatchSolver<DIM, Scalar>;
+
+    /* the same slack as in the solvers */
+    const Scalar slackEps = 1e-15;
+
+    const int r = AAt.rows();
+    const int m = Tt.cols();
+
+    /* KKT screening */
+    std::vector<char>& settled = ws.settled;
+    settled.resize(m);
+    #pragma omp parallel num_threads(nthreads)
+    {
+        VectorDD g = VectorDD::Zero(r, 1);
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < m; ++i) {
+            if (pinned && pinned[i]) {
+                settled[i] = 1;
+                continue;
+            }
+            g.noalias() = AAt * Tt.col(i);
+            g -= B.col(i);
+            settled[i] = Tt.col(i).minCoeff() >= 0 && Tt.col(i).maxCoeff() <= 1
+                && g.binaryExpr(Tt.col(i), ProjGradT<Scalar>(slackEps)).norm() <= tolT;
+        }
+    }
+
+    std::vector<int>& active = ws.active;
+    active.clear();
+    int npinned = 0;
+    for (int i = 0; i < m; ++i) {
+        if (!settled[i]) {
+            active.push_back(i);
+        }
+        else if (pinned && pinned[i]) {
+            ++npinned;
+        }
+    }
+    const int nactive = active.size();
+    long iters = 0;
+
+    /*
+     * Columns of Tt are independent subproblems sharing AAt.
+     * Every thread owns a solver (and hence its scratch space),
+     * each column is solved exactly as in the serial case,
+     * so the result does not depend on the number of threads.
+     * The factorization cache does not change the arithmetic either,
+     * a miss factors the free set the same way a hit was factored.
+     */
+    const bool batched = QPSolver::Method::coord_descent == method
+        || (QPSolver::Method::newton == method && QPBatchSolver::batchedNewton);
+    if (batched) {
+        /* The batched solvers advance blocks of columns at once,
+         * the active columns are gathered into contiguous blocks */
+        MatrixDX& Tact = ws.Tact;
+        MatrixDX& Bact = ws.Bact;
+        if (Tact.cols() < nactive) {
+            Tact.resize(r, m);
+            Bact.resize(r, m);
+        }
+        for (int k = 0; k < nactive; ++k) {
+            Tact.col(k) = Tt.col(active[k]);
+            Bact.col(k) = B.col(active[k]);
+        }
+
+        /* Newton's method refills its lanes within a chunk,
+         * coordinate descent solves a block of lanes at a time */
+        const bool newton = QPSolver::Method::newton == method;
+        const int chunk = newton ? 256 : QPBatchSolver::Lanes;
+        const int nchunks = (nactive + chunk - 1) / chunk;
+
+        #pragma omp parallel num_threads(nthreads)
+        {
+            QPBatchSolver solver(AAt, tolT, innerItersMax);
+            solver.setFactorizationCache(&factorizations);
+
+            #pragma omp for schedule(dynamic, newton ? 1 : 16) reduction(+:iters)
+            for (int c = 0; c < nchunks; ++c) {
+                if (gotSignal) {
+                    continue;
+                }
+                int first = c * chunk;
+                int count = std::min(chunk, nactive - first);
+                iters += newton ? solver.solveNewton(Tact, Bact, first, count)
+                    : solver.solve(Tact, Bact, first, count);
+            }
+        }
+
+        for (int k = 0; k < nactive; ++k) {
+            Tt.col(active[k]) = Tact.col(k);
+        }
+    }
+    else {
+        #pragma omp parallel num_threads(nthreads)
+        {
+            QPSolver solver(AAt, tolT, innerItersMax);
+            solver.setFactorizationCache(&factorizations);
+            VectorDD t = VectorDD::Zero(r, 1);
+
+            #pragma omp for schedule(dynamic, 256) reduction(+:iters)
+            for (int k = 0; k < nactive; ++k) {
+                /* cancelled, the remaining columns keep their values */
+                if (gotSignal) {
+                    continue;
+                }
+                const int i = active[k];
+                t = Tt.col(i);
+                solver.setRhs(B.col(i));
+                solver.solve(t, method);
+                iters += solver.getNumIters() - 1;
+                Tt.col(i) = t;
+            }
+        }
+    }
+
+    if (profile) {
+        profile->tStepColumns += nactive;
+        profile->tStepIters   += iters;
+        profile->screened     += m - nactive - npinned;
+    }
+
+    return m - nactive - npinned;
+}
+
+/* Some Voodoo magic to eliminate
+ * long switches for different dimensions */
+template <int ...> struct DimList {};
+
+/*
+ * The T-step of the free block when the last kfix rows of Tt
+ * are known components. The free block has k = r - kfix rows,
+ * known only at run time, so it is hidden behind this interface
+ * and instantiated for its own k (see makeFreeBlockTStep).
+ */
+template <typename Scalar>
+class FreeBlockTStep {
+public:
+    using MatrixX = Eigen::Matrix<Scalar, Dynamic, Dynamic>;
+
+    virtual ~FreeBlockTStep() {}
+
+    /* AAt restricted to the free rows, once per alternation */
+    virtual void reset(const MatrixX& AAtFree) = 0;
+
+    /* solveTStep for the free rows Tfree of a tile,
+     * Bfree already has the known rows moved to it */
+    virtual int solve(const MatrixX& Bfree, MatrixX& Tfree, int method, double tolT,
+            int innerItersMax, int nthreads, SolverProfile* profile, const char* pinned) = 0;
+};
+
+template <int K, typename Scalar>
+class FreeBlockTStepDim : public FreeBlockTStep<Scalar> {
+public:
+    using MatrixX = typename FreeBlockTStep<Scalar>::MatrixX;
+
+private:
+    Eigen::Matrix<Scalar, K, K> AAt;
+    Eigen::Matrix<Scalar, K, Dynamic> Tt, B;
+    FreeSetFactorizationCache<K, Scalar> factorizations;
+    TStepWorkspace<K, Scalar> ws;
+
+public:
+    FreeBlockTStepDim(int k, int m) : AAt(k, k), factorizations(k), ws(m) {}
+
+    void reset(const MatrixX& AAtFree) {
+        AAt = AAtFree;
+        factorizations.reset(AAt);
+    }
+
+    int solve(const MatrixX& Bfree, MatrixX& Tfree, int method, double tolT,
+            int innerItersMax, int nthreads, SolverProfile* profile, const char* pinned) {
+        Tt = Tfree;
+        B  = Bfree;
+        int skipped = solveTStep<K, Scalar>(AAt, B, Tt, method, tolT,
+                innerItersMax, nthreads, factorizations, ws, profile, pinned);
+        Tfree = Tt;
+        return skipped;
+    }
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/* border case, not reached as the list ends with Dynamic */
+template <typename Scalar>
+FreeBlockTStep<Scalar>* newFreeBlockTStep(int k, int m, DimList<>) {
+    return nullptr;
+}
+
+template <typename Scalar, int K, int ...KS>
+FreeBlockTStep<Scalar>* newFreeBlockTStep(int k, int m, DimList<K, KS...>) {
+    if (K != k && K != Dynamic) {
+        return newFreeBlockTStep<Scalar>(k, m, DimList<KS...>());
+    }
+    return new FreeBlockTStepDim<K, Scalar>(k, m);
+}
+
+/* The free block T-step instantiated for k free rows, as solveAnyDim does for r */
+template <typename Scalar>
+FreeBlockTStep<Scalar>* makeFreeBlockTStep(int k, int m) {
+    return newFreeBlockTStep<Scalar>(k, m, DimList<2, 3, 4, 5,
+            6, 7, 8, 9,
+            10, 11, 12,
+            13, 14, 15,
+            16, Dynamic>());
+}
+
+template <int DIM = -1, typename Scalar = Double>
+void applySolver(const DataSource<Scalar>& Dt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
+    using MatrixDD = Eigen::Matrix<Scalar, DIM, DIM>;
+    using MatrixDX = Eigen::Matrix<Scalar, DIM, Dynamic>;
+    using MatrixX  = typename DataSource<Scalar>::MatrixX;
+    using MatrixDDd = Eigen::Matrix<double, DIM, DIM>;
+    using MatrixDXd = Eigen::Matrix<double, DIM, Dynamic>;
+
+    size_t r = mAinit.rows();
+    size_t n = Dt.rows();
+    size_t m = Dt.cols();
+
+    /* Convert to Eigen's data types */
+    MatrixDX Tt = mTtinit.template cast<Scalar>();
+    MatrixDX A  = mAinit.template cast<Scalar>();
+
+    int niter = 1;
+    double optCond = 1e+10;
+    if (ctrl.resume && !ctrl.checkpoint.empty()) {
+        RMatrixOut Ad(r, n), Ttd(r, m);
+        int done = 0;
+        if (readCheckpoint(ctrl.checkpoint, ctrl, lambda, Ad, Ttd, done, optCond)) {
+            A  = Ad.template cast<Scalar>();
+            Tt = Ttd.template cast<Scalar>();
+            niter = done + 1;
+        }
+    }
+
+    /* Tolerances below the rounding level of Scalar are never met */
+    const double tolMin = 1e+02 * std::numeric_limits<Scalar>::epsilon();
+    tol  = std::max(tol, tolMin);
+    tolA = std::max(tolA, tolMin);
+    tolT = std::max(tolT, tolMin);
+
+    //TODO: make it a parameter!!!
+    int innerItersMax = 500;
+
+    /*
+     * Known components: Tt = [Tfree; Tfix] and A = [Afree; Afix].
+     * The T-step solves for the k rows of Tfree only,
+     * Tfix moves to the right-hand side as -AfreeAfix^T * Tfix.
+     * The free block is solved by the T-step instantiated for k.
+     */
+    const int kfix = ctrl.fixedRows;
+    const int k = r - kfix;
+
+    using QPSolver = QPBoxSolverSmallDims<DIM, Scalar>;
+    int method = QPSolver::Method::newton;
+    if (2 == k) {
+        method = QPSolver::Method::exact_rank_2;
+    }
+    else if (14 < k) {
+        method = QPSolver::Method::coord_descent;
+    }
+
+    /*
+     * Workspace of the alternations. The r x n, r x r and r x m
+     * matrices are sized here and reused, an alternation allocates
+     * no matrices of the problem size. It still allocates small ones:
+     * Eigen's products take blocking buffers from the heap, the tile
+     * buffers below are resized for a shorter last tile and the
+     * solvers of the T-step set up their scratch once per tile
+     * (on the heap for Dynamic).
+     */
+    MatrixDX Aprev(r, n);
+    /* Tt at the start of the alternation, saved if it is interrupted */
+    MatrixDX Ttprev(r, ctrl.checkpoint.empty() ? 0 : m);
+    MatrixDX TtD(r, n);
+    MatrixDX TtT(r, r);
+    MatrixDD AAt(r, r);
+    /* Tt * Dt^T, Tt * Tt^T and the objective are computed in double,
+     * in single precision the objective would lose its digits
+     * to the cancellation near convergence. The A-step reads
+     * them in Scalar. */
+    MatrixDXd TtDsum(r, n);
+    MatrixDXd TtTsum(r, r);
+    MatrixDXd Ad(r, n);
+    MatrixDDd AAtd(r, r);
+    TStepWorkspace<DIM, Scalar> tstepWs(m);
+
+    /* Hessian submatrix factorizations shared by all the columns */
+    FreeSetFactorizationCache<DIM, Scalar> factorizations(r);
+
+    /* T-step of the free block when there are known components */
+    MatrixX Tfree, Bfree;
+    std::unique_ptr<FreeBlockTStep<Scalar>> freeTStep;
+    if (kfix > 0) {
+        freeTStep.reset(makeFreeBlockTStep<Scalar>(k, m));
+    }
+
+    /* Reads TtD and TtT as they are at every A-step */
+    ProbSimplexProjector<DIM, Scalar> probSmplxProjector(TtD,
+            TtT, tolA, innerItersMax, nthreads);
+    if (!ctrl.pinnedSamples.empty()) {
+        probSmplxProjector.setPinnedColumns(ctrl.pinnedSamples.data());
+    }
+    if (!ctrl.lowerA.empty()) {
+        probSmplxProjector.setBounds(ctrl.lowerA, ctrl.upperA);
+    }
+    const char* pinnedCpGs = ctrl.pinnedCpGs.empty() ? nullptr : ctrl.pinnedCpGs.data();
+
+    /*
+     * The T-step goes over tiles of CpGs: B is formed for a tile,
+     * its columns are solved and Tt * Dt^T, Tt * Tt^T of the next A-step
+     * are accumulated while the tile is still in cache,
+     * so an alternation is a single pass over the data
+     * and B is never materialized for all the CpGs.
+     *
+     * Out-of-core data is read one block at a time, a tile is a block.
+     * A tile has at least 4096 CpGs to keep the threads of the T-step busy.
+     * Its width does not depend on the number of threads,
+     * neither do the sums over the tiles.
+     */
+    const bool streaming = Dt.streaming();
+    const Eigen::Index tileCols = Dt.tileCols();
+    MatrixX Dblock;
+    MatrixDX Tblock, Tblockprev, Bblock;
+    MatrixDXd Tblockd;
+
+    /* Adds Tt * Dt^T and Tt * Tt^T of the tile of Tblock at CpG j
+     * to the sums, Dblock holds the tile of a streaming source */
+    auto addTile = [&](Eigen::Index j, Eigen::Index w) {
+        Tblockd = Tblock.template cast<double>();
+        if (streaming) {
+            TtDsum.noalias() += Tblockd * Dblock.template cast<double>();
+        }
+        else {
+            Dt.rightMulTAddColsDouble(Tblockd, j, w, TtDsum);
+        }
+        TtTsum.noalias() += Tblockd * Tblockd.transpose();
+    };
+
+    supp.profile = SolverProfile();
+    SolverProfile* profile = ctrl.profile ? &supp.profile : nullptr;
+    Stopwatch clock, total;
+    if (profile) {
+        profile->tStepMethod = QPSolver::Method::newton == method ? "newton"
+            : QPSolver::Method::exact_rank_2 == method ? "exact_rank_2" : "coord_descent";
+        /* Tt * Dt^T of the initial Tt and ||Dt||^2 */
+        profile->dataPasses = 2;
+    }
 
     /*
-     * We have to set global variables after each call.
+     * Tt * Dt^T and Tt * Tt^T are updated at the end of every alternation,
+     * they feed the next A-step and give the objective
+     * 0.5 * (||Dt||^2 - 2 <A, Tt * Dt^T> + <AAt, Tt * Tt^T>) + lambda * ...
+     * without another pass over the data.
+     * The initial ones are summed over the same tiles, so a run resumed
+     * from a checkpoint continues with exactly the values it stopped with.
      */
-    gotSignal = false;
-    signal(SIGINT, setGotSignal);
-    signal(SIGTERM, setGotSignal);
-    signal(SIGKILL, setGotSignal);
+    TtDsum.setZero();
+    TtTsum.setZero();
+    for (Eigen::Index j = 0; j < (Eigen::Index)m; j += tileCols) {
+        Eigen::Index w = std::min<Eigen::Index>(tileCols, m - j);
+        Tblock = Tt.middleCols(j, w);
+        if (streaming) {
+            Dt.readBlock(j, w, Dblock);
+        }
+        addTile(j, w);
+    }
+    TtD = TtDsum.template cast<Scalar>();
+    TtT = TtTsum.template cast<Scalar>();
+    const double normD2 = Dt.squaredResidual(MatrixX(0, n), MatrixX(0, m), nthreads);
 
-    RMatrixIn mDt(as<RMatrixIn>(mDtSEXP));
-    RMatrixIn mTtinit(as<RMatrixIn>(mTtinitSEXP));
-    RMatrixIn mAinit(as<RMatrixIn>(mAinitSEXP));
+    std::unique_ptr<TraceWriter> traceWriter;
+    if (!ctrl.traceFile.empty()) {
+        traceWriter.reset(new TraceWriter(ctrl.traceFile, ctrl.traceLabel, lambda));
+    }
+    supp.trace = SolverTrace();
+
+    supp.skipped.clear();
+    supp.checkpointFailed = false;
+    bool halfway = false;
+    while (niter <= itersMax && optCond > tol && !gotSignal) {
+        Aprev  = A;
+        if (!ctrl.checkpoint.empty()) {
+            Ttprev = Tt;
+        }
+
+        /*
+        * Optimization wrt A {
+        */
+        if (profile) {
+            clock.lap();
+        }
+        probSmplxProjector.solve(A);
+        if (profile) {
+            const int aIters = probSmplxProjector.getNumIters() - 1;
+            profile->aStepIters  += aIters;
+            profile->projections += long(aIters) * n;
+            profile->aStepTime   += clock.lap();
+        }
+
+        /*
+        * }
+        */
+
+        /*
+        * Optimization wrt T {
+        */
+        AAt.noalias() = A * A.transpose();
+        if (kfix > 0) {
+            freeTStep->reset(AAt.topLeftCorner(k, k));
+        }
+        else {
+            factorizations.reset(AAt);
+        }
+        if (profile) {
+            profile->formTime += clock.lap();
+        }
+
+        double dT2 = 0.0;
+        int skipped = 0;
+        TtDsum.setZero();
+        TtTsum.setZero();
+        for (Eigen::Index j = 0; j < (Eigen::Index)m && !gotSignal; j += tileCols) {
+            Eigen::Index w = std::min<Eigen::Index>(tileCols, m - j);
+            Tblock = Tt.middleCols(j, w);
+            Tblockprev = Tblock;
+            /* B = A * Dt - lambda * (1 - 2 * Tt) for the tile,
+             * the lambda term first, the product accumulates onto it */
+            Bblock = Scalar(lambda) * (2 * Tblockprev.array() - 1).matrix();
+            if (streaming) {
+                Dt.readBlock(j, w, Dblock);
+                Bblock.noalias() += A * Dblock.transpose();
+            }
+            else {
+                Dt.leftMulAddCols(A, j, w, Bblock);
+            }
+            if (profile) {
+                profile->formTime += clock.lap();
+            }
+
+            if (kfix > 0) {
+                Tfree = Tblock.topRows(k);
+                Bfree = Bblock.topRows(k);
+                Bfree.noalias() -= AAt.topRightCorner(k, kfix) * Tblock.bottomRows(kfix);
+                skipped += freeTStep->solve(Bfree, Tfree, method, tolT,
+                        innerItersMax, nthreads, profile,
+                        pinnedCpGs ? pinnedCpGs + j : nullptr);
+                Tblock.topRows(k) = Tfree;
+            }
+            else {
+                skipped += solveTStep<DIM, Scalar>(AAt, Bblock, Tblock, method, tolT,
+                        innerItersMax, nthreads, factorizations, tstepWs, profile,
+                        pinnedCpGs ? pinnedCpGs + j : nullptr);
+            }
+            if (profile) {
+                profile->tStepTime += clock.lap();
+            }
+
+            /* for the next A-step */
+            dT2 += (Tblockprev - Tblock).squaredNorm();
+            Tt.middleCols(j, w) = Tblock;
+            addTile(j, w);
+            if (profile) {
+                profile->aStepTime += clock.lap();
+            }
+        }
+        TtD = TtDsum.template cast<Scalar>();
+        TtT = TtTsum.template cast<Scalar>();
+        if (profile) {
+            profile->dataPasses += 1;
+        }
+        supp.skipped.push_back(skipped);
+        /*
+        * }
+        */
+
+        /* an interrupted alternation is not counted */
+        if (gotSignal) {
+            halfway = true;
+            break;
+        }
+
+        ++niter;
+        double dA = (Aprev - A).norm() / std::sqrt(r * n);
+        double dT = std::sqrt(dT2) / std::sqrt(r * m);
+        optCond = std::sqrt(dA * dA + dT * dT);
+
+        Ad = A.template cast<double>();
+        AAtd.noalias() = Ad * Ad.transpose();
+        double objF = 0.5 * (normD2 - 2.0 * Ad.cwiseProduct(TtDsum).sum()
+                + AAtd.cwiseProduct(TtTsum).sum())
+            + lambda * binaryPenalty(Tt, k);
+        double elapsed = total.elapsed();
+        supp.trace.objF.push_back(objF);
+        supp.trace.dA.push_back(dA);
+        supp.trace.dT.push_back(dT);
+        supp.trace.elapsed.push_back(elapsed);
+        if (traceWriter) {
+            traceWriter->write(niter - 1, objF, dA, dT, elapsed);
+        }
+
+        if (ctrl.checkpointEvery > 0 && !ctrl.checkpoint.empty()
+                && 0 == (niter - 1) % ctrl.checkpointEvery) {
+            supp.checkpointFailed |= !writeCheckpoint(ctrl.checkpoint, ctrl, niter - 1,
+                    optCond, lambda, A, Tt);
+        }
+    }
+
+    supp.interrupted = gotSignal;
+    if (supp.interrupted && !ctrl.checkpoint.empty()) {
+        /* A and Tt of an alternation cut short are partly updated,
+         * the state it started from is saved instead */
+        supp.checkpointFailed |= halfway
+            ? !writeCheckpoint(ctrl.checkpoint, ctrl, niter - 1, optCond, lambda, Aprev, Ttprev)
+            : !writeCheckpoint(ctrl.checkpoint, ctrl, niter - 1, optCond, lambda, A, Tt);
+    }
+    else if (!ctrl.checkpoint.empty()) {
+        /* nothing to resume, a later run with the same file
+         * (another start or lambda) must not pick up this state */
+        std::remove(ctrl.checkpoint.c_str());
+    }
+
+    /*
+     * Forming output
+     */
+    mTtout  = Tt.template cast<double>();
+    mAout   = A.template cast<double>();
+    supp.niters = niter - 1;
+    clock.lap();
+    supp.rmse   = 0.5 * Dt.squaredResidual(A, Tt, nthreads);
+    supp.objF   = supp.rmse + lambda * binaryPenalty(Tt, k);
+    supp.rmse  /= m;
+    supp.rmse  /= n;
+    if (profile) {
+        profile->residualTime += clock.lap();
+        profile->dataPasses   += 1;
+        profile->totalTime     = total.elapsed();
+    }
+}
+
+/* border case */
+template <typename Scalar>
+void solve(int d, const DataSource<Scalar>& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp,
+        DimList<>) {
+}
+
+template <typename Scalar, int DIM, int ...DIMS>
+void solve(int d, const DataSource<Scalar>& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp,
+        DimList<DIM, DIMS...>) {
+    if (DIM != d) {
+        return solve(d, mDt, mTtinit, mAinit, lambda,
+                itersMax, tol, tolA, tolT, nthreads, ctrl,
+                mTtout, mAout, supp,
+                DimList<DIMS...>());
+    }
+
+    applySolver<DIM>(mDt, mTtinit, mAinit, lambda,
+            itersMax, tol, tolA, tolT, nthreads, ctrl,
+            mTtout, mAout, supp);
+}
+
+template <int ...DIMS, typename Scalar>
+void solve(int d, const DataSource<Scalar>& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
+        solve(d, mDt, mTtinit, mAinit, lambda,
+                itersMax, tol, tolA, tolT, nthreads, ctrl,
+                mTtout, mAout, supp,
+                DimList<DIMS...>());
+}
 
+/* Dispatches a run to the instantiation for its rank */
+template <typename Scalar>
+void solveAnyDim(const DataSource<Scalar>& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
     /* Dimensionality of a problem */
-    const size_t d = mAinit.rows() > 16 ? Dynamic : mAinit.rows();
+    const int d = mAinit.rows() > 16 ? Dynamic : mAinit.rows();
 
-    RMatrixOut mTtout, mAout;
-    SolverSuppOutput supp;
     solve<2, 3, 4, 5,
           6, 7, 8, 9,
           10, 11, 12,
           13, 14, 15,
           16, Dynamic>(d, mDt, mTtinit, mAinit, lambda, itersMax,
-                  tol, tolA, tolT,
+                  tol, tolA, tolT, nthreads, ctrl,
                   mTtout, mAout, supp);
+}
+
+/*
+ * Dt in the precision requested from R:
+ *  "double" - Dt is used in place, computations in double;
+ *  "single" - Dt is stored and the problem is solved in float;
+ *  "mixed"  - Dt is stored in float, computations in double.
+ * Exactly one of dbl and flt is set.
+ *
+ * Dt is either an R matrix or the path of a file holding D (m x n)
+ * as raw column-major doubles or floats, e.g. written by writeBin()
+ * or the backing file of an ff matrix. The file is memory-mapped
+ * and used in place, float files are served as "mixed" unless
+ * "single" is requested. With streamBlock > 0 the file is instead
+ * read in blocks of streamBlock CpGs on every alternation.
+ */
+struct DataSources {
+    std::unique_ptr<MappedFile> file;
+    std::vector<float> storage;
+    std::unique_ptr<DataSource<double>> dbl;
+    std::unique_ptr<DataSource<float>> flt;
+
+    DataSources(const RMatrixIn& mDt, const std::string& precision) {
+        checkPrecision(precision);
+        if ("double" == precision) {
+            dbl.reset(new DenseDataSource<double>(mDt.data(), mDt.rows(), mDt.cols()));
+            return;
+        }
+
+        storage.assign(mDt.data(), mDt.data() + mDt.size());
+        if ("single" == precision) {
+            flt.reset(new DenseDataSource<float>(storage.data(), mDt.rows(), mDt.cols()));
+        }
+        else {
+            dbl.reset(new DenseDataSource<double, float>(storage.data(), mDt.rows(), mDt.cols()));
+        }
+    }
+
+    /* n samples and m CpGs are known from the initial values */
+    DataSources(const std::string& path, Eigen::Index n, Eigen::Index m,
+            const std::string& precision, Eigen::Index streamBlock) {
+        checkPrecision(precision);
+
+        const size_t numel = size_t(n) * size_t(m);
+        const size_t elsize = elementSize(path, n, m);
+        if (streamBlock > 0) {
+            if (sizeof(double) == elsize) {
+                if ("single" == precision) {
+                    flt.reset(new StreamingDataSource<float, double>(path, n, m, streamBlock));
+                }
+                else {
+                    dbl.reset(new StreamingDataSource<double>(path, n, m, streamBlock));
+                }
+            }
+            else {
+                if ("single" == precision) {
+                    flt.reset(new StreamingDataSource<float>(path, n, m, streamBlock));
+                }
+                else {
+                    dbl.reset(new StreamingDataSource<double, float>(path, n, m, streamBlock));
+                }
+            }
+            return;
+        }
+
+        file.reset(new MappedFile(path));
+        if (sizeof(double) == elsize) {
+            const double* data = static_cast<const double*>(file->data());
+            if ("double" == precision) {
+                dbl.reset(new TransposedDataSource<double>(data, n, m));
+                return;
+            }
+
+            storage.assign(data, data + numel);
+            if ("single" == precision) {
+                flt.reset(new TransposedDataSource<float>(storage.data(), n, m));
+            }
+            else {
+                dbl.reset(new TransposedDataSource<double, float>(storage.data(), n, m));
+            }
+        }
+        else {
+            const float* data = static_cast<const float*>(file->data());
+            if ("single" == precision) {
+                flt.reset(new TransposedDataSource<float>(data, n, m));
+            }
+            else {
+                dbl.reset(new TransposedDataSource<double, float>(data, n, m));
+            }
+        }
+    }
+
+    inline Eigen::Index rows() const {
+        return flt ? flt->rows() : dbl->rows();
+    }
+
+    inline Eigen::Index cols() const {
+        return flt ? flt->cols() : dbl->cols();
+    }
+
+    inline size_t elementBytes() const {
+        return flt ? flt->elementBytes() : dbl->elementBytes();
+    }
+
+private:
+    /* Size of the elements of a file with D, doubles or floats */
+    static size_t elementSize(const std::string& path, Eigen::Index n, Eigen::Index m) {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in) {
+            throw std::runtime_error("cannot open '" + path + "'");
+        }
+
+        const size_t size  = in.tellg();
+        const size_t numel = size_t(n) * size_t(m);
+        if (size != numel * sizeof(double) && size != numel * sizeof(float)) {
+            throw std::runtime_error("size of '" + path + "' does not match a "
+                    + std::to_string(m) + " x " + std::to_string(n)
+                    + " matrix of doubles or floats");
+        }
+
+        return size / numel;
+    }
+
+    static void checkPrecision(const std::string& precision) {
+        if ("double" != precision && "single" != precision && "mixed" != precision) {
+            throw std::runtime_error("unknown precision '" + precision
+                    + "', expected 'double', 'single' or 'mixed'");
+        }
+    }
+};
+
+/* Dt from an R matrix or a file path, see DataSources */
+DataSources* makeDataSources(SEXP mDtSEXP, Eigen::Index n, Eigen::Index m,
+        const std::string& precision, int streamBlock) {
+    if (STRSXP == TYPEOF(mDtSEXP)) {
+        return new DataSources(as<std::string>(mDtSEXP), n, m, precision, streamBlock);
+    }
+
+    RMatrixIn mDt(as<RMatrixIn>(mDtSEXP));
+    if (mDt.rows() != n || mDt.cols() != m) {
+        stop("dimensions of the data matrix do not match the initial values");
+    }
+
+    return new DataSources(mDt, precision);
+}
+
+void solveAnyPrecision(const DataSources& mDt, const RMatrixIn& mTtinit, const RMatrixIn& mAinit,
+        double lambda, int itersMax, double tol, double tolA, double tolT, int nthreads,
+        const SolverControl& ctrl,
+        RMatrixOut& mTtout, RMatrixOut& mAout, SolverSuppOutput& supp) {
+    if (mDt.flt) {
+        solveAnyDim(*mDt.flt, mTtinit, mAinit, lambda, itersMax,
+                tol, tolA, tolT, nthreads, ctrl, mTtout, mAout, supp);
+    }
+    else {
+        solveAnyDim(*mDt.dbl, mTtinit, mAinit, lambda, itersMax,
+                tol, tolA, tolT, nthreads, ctrl, mTtout, mAout, supp);
+    }
+}
+
+/* SolverProfile as an R list, bytes are those of Dt as stored */
+List profileList(const SolverProfile& profile, const DataSources& data) {
+    const double passBytes = double(data.rows()) * double(data.cols()) * data.elementBytes();
+
+    return List::create(
+            Named("time") = NumericVector::create(
+                Named("astep")    = profile.aStepTime,
+                Named("form")     = profile.formTime,
+                Named("tstep")    = profile.tStepTime,
+                Named("residual") = profile.residualTime,
+                Named("total")    = profile.totalTime),
+            Named("astep.iters")   = double(profile.aStepIters),
+            Named("projections")   = double(profile.projections),
+            Named("tstep.method")  = profile.tStepMethod,
+            Named("tstep.columns") = double(profile.tStepColumns),
+            Named("tstep.iters")   = double(profile.tStepIters),
+            Named("screened")      = double(profile.screened),
+            Named("data.passes")   = double(profile.dataPasses),
+            Named("bytes")         = profile.dataPasses * passBytes);
+}
+
+/* Flags of the 1-based indices in idx, empty if there are none */
+std::vector<char> pinnedFlags(const IntegerVector& idx, Eigen::Index size, const char* what) {
+    std::vector<char> flags;
+    if (0 == idx.size()) {
+        return flags;
+    }
+
+    flags.assign(size, 0);
+    for (int i = 0; i < idx.size(); ++i) {
+        if (idx[i] < 1 || idx[i] > size) {
+            stop("%s: index %d out of range", what, idx[i]);
+        }
+        flags[idx[i] - 1] = 1;
+    }
+
+    return flags;
+}
+
+/* SolverTrace as an R list of equally long vectors */
+List traceList(const SolverTrace& trace) {
+    return List::create(Named("objF")    = trace.objF,
+                        Named("dA")      = trace.dA,
+                        Named("dT")      = trace.dT,
+                        Named("elapsed") = trace.elapsed);
+}
+
+// [[Rcpp::export]]
+RcppExport SEXP cppTAfact(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP,
+        double lambda = 0.0, int itersMax = 1000,
+        double tol = 1e-8, double tolA = 1e-7, double tolT = 1e-7,
+        int nthreads = 1, std::string precision = "double", int streamBlock = 0,
+        std::string checkpoint = "", int checkpointEvery = 0, bool resume = false,
+        bool profile = false, std::string traceFile = "", std::string traceLabel = "",
+        int fixedRows = 0, IntegerVector pinnedCpGs = IntegerVector::create(),
+        IntegerVector pinnedSamples = IntegerVector::create(),
+        NumericVector lowerA = NumericVector::create(),
+        NumericVector upperA = NumericVector::create()) {
+    /* Prepare Eigen for multithreading.
+     * Threads are spent on the per-column T-step,
+     * Eigen's own products stay single-threaded. */
+    Eigen::initParallel();
+    Eigen::setNbThreads(1);
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    /* SIGINT/SIGTERM stop the run cooperatively,
+     * the state is saved if a checkpoint file is given */
+    SignalGuard signalGuard;
+
+    SolverControl ctrl;
+    ctrl.checkpoint = checkpoint;
+    ctrl.checkpointEvery = checkpointEvery;
+    ctrl.resume = resume;
+    ctrl.profile = profile;
+    ctrl.traceFile = traceFile;
+    ctrl.traceLabel = traceLabel;
+    ctrl.fixedRows = fixedRows;
+
+    RMatrixIn mTtinit(as<RMatrixIn>(mTtinitSEXP));
+    RMatrixIn mAinit(as<RMatrixIn>(mAinitSEXP));
+    if (fixedRows < 0 || fixedRows >= mTtinit.rows()) {
+        stop("fixedRows should be between 0 and the rank minus one");
+    }
+    ctrl.pinnedCpGs = pinnedFlags(pinnedCpGs, mTtinit.cols(), "pinnedCpGs");
+    ctrl.pinnedSamples = pinnedFlags(pinnedSamples, mAinit.cols(), "pinnedSamples");
+    if (lowerA.size() > 0 || upperA.size() > 0) {
+        ctrl.lowerA.assign(lowerA.begin(), lowerA.end());
+        ctrl.upperA.assign(upperA.begin(), upperA.end());
+        CheckSplxBox(ctrl.lowerA.data(), ctrl.lowerA.size(), ctrl.upperA.data(),
+                ctrl.upperA.size(), mAinit.rows(), "lowerA", "upperA");
+    }
+    std::unique_ptr<DataSources> data(makeDataSources(mDtSEXP,
+                mAinit.cols(), mTtinit.cols(), precision, streamBlock));
+
+    RMatrixOut mTtout, mAout;
+    SolverSuppOutput supp;
+    solveAnyPrecision(*data, mTtinit, mAinit, lambda, itersMax,
+            tol, tolA, tolT, nthreads, ctrl,
+            mTtout, mAout, supp);
+
+    if (supp.checkpointFailed) {
+        Rf_warning("could not write checkpoint '%s'", checkpoint.c_str());
+    }
+
+    return wrap(List::create(Named("Tt")          = mTtout,
+                             Named("A")           = mAout,
+                             Named("niter")       = supp.niters,
+                             Named("objF")        = supp.objF,
+                             Named("rmse")        = supp.rmse,
+                             Named("skipped")     = supp.skipped,
+                             Named("interrupted") = supp.interrupted,
+                             Named("trace")       = traceList(supp.trace),
+                             Named("profile")     = profile
+                                 ? SEXP(profileList(supp.profile, *data)) : R_NilValue));
+}
+
+/*
+ * Runs cppTAfact from several initializations at once.
+ *
+ * mTtinitsSEXP and mAinitsSEXP are lists of equal length
+ * holding the initial values (transposed T and A) of each run.
+ * Dt (a matrix or a file path, as for cppTAfact)
+ * is mapped once and shared read-only by all the runs,
+ * which are distributed over nthreads threads.
+ */
+// [[Rcpp::export]]
+RcppExport SEXP cppTAfactMulti(SEXP mDtSEXP, SEXP mTtinitsSEXP, SEXP mAinitsSEXP,
+        double lambda = 0.0, int itersMax = 1000,
+        double tol = 1e-8, double tolA = 1e-7, double tolT = 1e-7,
+        int nthreads = 1, std::string precision = "double", int streamBlock = 0) {
+    Eigen::initParallel();
+    Eigen::setNbThreads(1);
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    SignalGuard signalGuard;
+    SolverControl ctrl;
+
+    List mTtinits(mTtinitsSEXP);
+    List mAinits(mAinitsSEXP);
+
+    const int nruns = mTtinits.size();
+    if (nruns != mAinits.size()) {
+        stop("the numbers of initial values for Tt and A differ");
+    }
+
+    /* R objects must not be touched from the worker threads,
+     * so all the inputs are mapped beforehand */
+    std::vector<RMatrixIn> Ttinits;
+    std::vector<RMatrixIn> Ainits;
+    for (int run = 0; run < nruns; ++run) {
+        SEXP mTtinitSEXP = mTtinits[run];
+        SEXP mAinitSEXP  = mAinits[run];
+        Ttinits.push_back(as<RMatrixIn>(mTtinitSEXP));
+        Ainits.push_back(as<RMatrixIn>(mAinitSEXP));
+    }
+    if (0 == nruns) {
+        return wrap(List::create(Named("runs") = List(0),
+                                 Named("objF") = NumericVector(0)));
+    }
+
+    std::unique_ptr<DataSources> data(makeDataSources(mDtSEXP,
+                Ainits[0].cols(), Ttinits[0].cols(), precision, streamBlock));
+
+    for (int run = 0; run < nruns; ++run) {
+        if (Ttinits[run].cols() != data->cols() || Ainits[run].cols() != data->rows()
+                || Ttinits[run].rows() != Ainits[run].rows()) {
+            stop("initial values of run %d do not match the data matrix", run + 1);
+        }
+    }
+
+    std::vector<RMatrixOut> Ttouts(nruns), Aouts(nruns);
+    std::vector<SolverSuppOutput> supps(nruns);
+
+    /* One run per thread, the T-step of a run is then serial.
+     * The solver and the data sources throw plain std::exceptions
+     * (e.g. failed reads), never Rcpp ones, which would call R here.
+     * They must not leave the parallel region, the first one
+     * is turned into an R error on the master thread afterwards */
+    std::string error;
+    #pragma omp parallel for schedule(dynamic, 1) num_threads(std::min(nthreads, std::max(nruns, 1)))
+    for (int run = 0; run < nruns; ++run) {
+        try {
+            solveAnyPrecision(*data, Ttinits[run], Ainits[run], lambda, itersMax,
+                    tol, tolA, tolT, 1, ctrl,
+                    Ttouts[run], Aouts[run], supps[run]);
+        }
+        catch (std::exception& e) {
+            #pragma omp critical
+            if (error.empty()) {
+                error = e.what();
+            }
+        }
+    }
+    if (!error.empty()) {
+        stop(error);
+    }
+
+    List runs(nruns);
+    NumericVector objF(nruns);
+    for (int run = 0; run < nruns; ++run) {
+        runs[run] = List::create(Named("Tt")          = Ttouts[run],
+                                 Named("A")           = Aouts[run],
+                                 Named("niter")       = supps[run].niters,
+                                 Named("objF")        = supps[run].objF,
+                                 Named("rmse")        = supps[run].rmse,
+                                 Named("skipped")     = supps[run].skipped,
+                                 Named("interrupted") = supps[run].interrupted,
+                                 Named("trace")       = traceList(supps[run].trace));
+        objF[run] = supps[run].objF;
+    }
+
+    return wrap(List::create(Named("runs") = runs,
+                             Named("objF") = objF));
+}
+
+/*
+ * Solves cppTAfact along a grid of lambdas.
+ *
+ * The grid is swept in increasing order, the first lambda starts from
+ * mTtinit and mAinit and every other one from the solution for
+ * the previous (smaller) lambda. Results are returned
+ * in the order of the grid as given.
+ * A signal ends the sweep with the interrupted lambda,
+ * the ones it did not reach get NULL runs.
+ */
+// [[Rcpp::export]]
+RcppExport SEXP cppTAfactPath(SEXP mDtSEXP, SEXP mTtinitSEXP, SEXP mAinitSEXP,
+        NumericVector lambdas, int itersMax = 1000,
+        double tol = 1e-8, double tolA = 1e-7, double tolT = 1e-7,
+        int nthreads = 1, std::string precision = "double", int streamBlock = 0) {
+    Eigen::initParallel();
+    Eigen::setNbThreads(1);
+
+    if (nthreads < 1) {
+        nthreads = 1;
+    }
+
+    SignalGuard signalGuard;
+    SolverControl ctrl;
+
+    RMatrixIn mTtinit(as<RMatrixIn>(mTtinitSEXP));
+    RMatrixIn mAinit(as<RMatrixIn>(mAinitSEXP));
+    std::unique_ptr<DataSources> data(makeDataSources(mDtSEXP,
+                mAinit.cols(), mTtinit.cols(), precision, streamBlock));
+
+    const int npoints = lambdas.size();
+    std::vector<int> order(npoints);
+    for (int i = 0; i < npoints; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(),
+            [&lambdas](int i, int j) { return lambdas[i] < lambdas[j]; });
+
+    std::vector<RMatrixOut> Ttouts(npoints), Aouts(npoints);
+    std::vector<SolverSuppOutput> supps(npoints);
+    std::vector<char> reached(npoints, 0);
+    for (int k = 0; k < npoints; ++k) {
+        const int curr = order[k];
+        if (0 == k) {
+            solveAnyPrecision(*data, mTtinit, mAinit, lambdas[curr], itersMax,
+                    tol, tolA, tolT, nthreads, ctrl,
+                    Ttouts[curr], Aouts[curr], supps[curr]);
+        }
+        else {
+            /* warm start from the neighbouring solution */
+            RMatrixOut& Ttprev = Ttouts[order[k - 1]];
+            RMatrixOut& Aprev  = Aouts[order[k - 1]];
+            RMatrixIn mTtwarm(Ttprev.data(), Ttprev.rows(), Ttprev.cols());
+            RMatrixIn mAwarm(Aprev.data(), Aprev.rows(), Aprev.cols());
+            solveAnyPrecision(*data, mTtwarm, mAwarm, lambdas[curr], itersMax,
+                    tol, tolA, tolT, nthreads, ctrl,
+                    Ttouts[curr], Aouts[curr], supps[curr]);
+        }
+        reached[curr] = 1;
+        if (supps[curr].interrupted) {
+            break;
+        }
+    }
+
+    List runs(npoints);
+    NumericVector objF(npoints);
+    IntegerVector niter(npoints);
+    for (int i = 0; i < npoints; ++i) {
+        if (!reached[i]) {
+            runs[i]  = R_NilValue;
+            objF[i]  = NA_REAL;
+            niter[i] = NA_INTEGER;
+            continue;
+        }
+        runs[i] = List::create(Named("Tt")          = Ttouts[i],
+                               Named("A")           = Aouts[i],
+                               Named("niter")       = supps[i].niters,
+                               Named("objF")        = supps[i].objF,
+                               Named("rmse")        = supps[i].rmse,
+                               Named("skipped")     = supps[i].skipped,
+                               Named("interrupted") = supps[i].interrupted,
+                               Named("trace")       = traceList(supps[i].trace),
+                               Named("lambda")      = lambdas[i]);
+        objF[i]  = supps[i].objF;
+        niter[i] = supps[i].niters;
+    }
+
+    return wrap(List::create(Named("runs")  = runs,
+                             Named("objF")  = objF,
+                             Named("niter") = niter));
+}
+
+/*
+ * || D - T * A ||_F^2 for D (m x n), T (m x r) and A (r x n)
+ * as R stores them. D is read in tiles of CpGs on nthreads threads,
+ * D - T * A is never formed for the whole matrix.
+ */
+// [[Rcpp::export]]
+double cppSquaredResidual(SEXP mDSEXP, SEXP mTSEXP, SEXP mASEXP, int nthreads = 1) {
+    Eigen::initParallel();
+    Eigen::setNbThreads(1);
+
+    RMatrixIn mD(as<RMatrixIn>(mDSEXP));
+    RMatrixIn mT(as<RMatrixIn>(mTSEXP));
+    RMatrixIn mA(as<RMatrixIn>(mASEXP));
+    if (mT.rows() != mD.rows() || mA.cols() != mD.cols() || mT.cols() != mA.rows()) {
+        stop("non-conformable arguments");
+    }
+
+    /* D in R's layout is Dt in row-major order */
+    TransposedDataSource<double> Dt(mD.data(), mD.cols(), mD.rows());
+    Eigen::MatrixXd Tt = mT.transpose();
 
-    return wrap(List::create(Named("Tt")    = mTtout,
-                             Named("A")     = mAout,
-                             Named("niter") = supp.niters,
-                             Named("objF")  = supp.objF,
-                             Named("rmse")  = supp.rmse));
+    return Dt.squaredResidual(mA, Tt, std::max(nthreads, 1));
 }
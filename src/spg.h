@@ -0,0 +1,576 @@
+/*
+ * Spectral projected gradient (SPG) for batches of small QPs
+ *
+ * For each clm w of W (k,d) solve
+ *
+ * min     a' * G * a - 2 * w' * a + shift * sum(a),
+ * sb.to.  a in C,
+ *
+ * where the starting value (the estimate of the minimizer)
+ * is stored in the corresponding clm of A.
+ *
+ * The feasible set C is given by a projection policy, a class with
+ *
+ *   void operator()(double* x, ptrdiff_t k);   - project x onto C in place
+ *   static const bool firstOrderCheck;         - whether to stop on
+ *                                                norm(Proj(x-g)-x,1) < optTol
+ *   static const bool lipschitzStep;           - whether the first BB
+ *                                                parameter is 1/L
+ *
+ * Every thread works on its own copy of the policy, so it may keep
+ * scratch memory. HyperCubeProjection is defined below, the simplex
+ * projections live with their R entry points.
+ *
+ * ---Algorithm---
+ *
+ * SPG with BB step lengths and a non-monotone line search.
+ * The Hessian 2 * G and its largest eigenvalue L are computed once,
+ * the first BB parameter of every clm is 1/L if the policy asks for it.
+ * Otherwise the first step is the gradient scaled to unit 1-norm,
+ * which ends at lower losses on the simplices.
+ *
+ * The clms are solved in panels of SPG_PANEL clms advanced together:
+ * the products with the Hessian are one dgemm for all the running clms
+ * of a panel, the BB parameter, the line search and the stopping rules
+ * are kept per clm. For k = 2..16 this per clm arithmetic is
+ * specialized on k and unrolled by the compiler instead of going
+ * through BLAS.
+ *
+ * Panels are shared by the threads, the loss is summed in clm order,
+ * so the results do not depend on the number of threads.
+ *
+ * ---Default parameters---
+ *
+ * suffcient descent criterion in line search: 1e-3
+ * memory size in non-mono. descent checking: 10
+ * max #iterations per clm: 500
+ * #clms per panel : 64
+ *
+ */
+
+#ifndef _SPG_H
+#define _SPG_H
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <omp.h>
+#include "dynblas.h"
+
+#define MEM_OLD_VALUES 10
+#define SUFF_DESC 1e-3
+#define SPG_PANEL 64
+#define SPG_ITERMAX 500
+
+/*
+ * vector arithmetic on clms of length k, K > 0 fixes k at compile time,
+ * K = 0 is any k
+ */
+template <int K>
+struct SPGArith {
+    static inline ptrdiff_t size(ptrdiff_t k) {
+        return K > 0 ? K : k;
+    }
+
+    /* y = x */
+    static inline void copy(const double* x, double* y, ptrdiff_t k) {
+        const ptrdiff_t n = size(k);
+        for (ptrdiff_t i = 0; i < n; i++)
+            y[i] = x[i];
+    }
+
+    /* y = a * x + y */
+    static inline void axpy(double a, const double* x, double* y, ptrdiff_t k) {
+        const ptrdiff_t n = size(k);
+        for (ptrdiff_t i = 0; i < n; i++)
+            y[i] += a * x[i];
+    }
+
+    /* x' * y */
+    static inline double dot(const double* x, const double* y, ptrdiff_t k) {
+        const ptrdiff_t n = size(k);
+        double sum = 0.0;
+        for (ptrdiff_t i = 0; i < n; i++)
+            sum += x[i] * y[i];
+        return sum;
+    }
+
+    /* norm(x,1) */
+    static inline double asum(const double* x, ptrdiff_t k) {
+        const ptrdiff_t n = size(k);
+        double sum = 0.0;
+        for (ptrdiff_t i = 0; i < n; i++)
+            sum += std::fabs(x[i]);
+        return sum;
+    }
+
+    /*
+     * Y = H * X for the first ncols clms of X, H is (k,k);
+     * one dgemm for any K, faster than the unrolled loops at these sizes
+     */
+    static inline void gemm(const double* H, const double* X, double* Y, ptrdiff_t k, ptrdiff_t ncols) {
+        char* chn = (char*)"N";
+        double one  = 1.0;
+        double zero = 0.0;
+        k = size(k);
+        if (ncols > 0)
+            dgemm(chn, chn, &k, &ncols, &k, &one, H, &k, X, &k, &zero, Y, &k);
+    }
+};
+
+/* projection onto the hypercube lower <= a <= upper */
+struct HyperCubeProjection {
+    static const bool firstOrderCheck = true;
+    static const bool lipschitzStep = true;
+
+    double lower, upper;
+
+    HyperCubeProjection(double lower, double upper) : lower(lower), upper(upper) {}
+
+    void operator()(double* x, ptrdiff_t k) {
+        for (ptrdiff_t i = 0; i < k; i++) {
+            if (x[i] < lower)
+                x[i] = lower;
+            else if (x[i] > upper)
+                x[i] = upper;
+        }
+    }
+};
+
+/*
+ * estimate the largest eigenvalue of Hess, i.e. the Lipschitz constant
+ * of the gradient, by power iterations
+ */
+inline double GetLipschitz(const double* Hess, ptrdiff_t k){
+
+    // start from the all-ones direction: the Gram matrices of
+    // nonnegative factors have nonnegative entries
+    std::vector<double> v(k, 1.0 / std::sqrt((double)k)), Hv(k);
+    double L = 0.0;
+    for(int iter = 0; iter < 100; iter++){
+        // Hv = Hess * v, Rayleigh quotient at the unit vector v
+        SPGArith<0>::gemm(Hess, v.data(), Hv.data(), k, 1);
+        double L_new = SPGArith<0>::dot(v.data(), Hv.data(), k);
+        double norm = std::sqrt(SPGArith<0>::dot(Hv.data(), Hv.data(), k));
+        if (norm == 0)
+            return 0.0;
+        for(ptrdiff_t i = 0; i < k; i++){
+            v[i] = Hv[i] / norm;
+        }
+
+        bool converged = std::fabs(L_new - L) <= 1e-6 * L_new;
+        L = L_new;
+        if (converged)
+            break;
+    }
+    return L;
+}
+
+/*
+ * state of a panel of SPG subproblems, one slot per clm;
+ * vectors are stored clm by clm (k, nb), old_fvals is (MEM_OLD_VALUES, nb)
+ */
+struct SPGPanel {
+    std::vector<double> beta, x, x_old, g, g_old, d, Hd, old_fvals;
+    std::vector<double> f, fmin, gtd, red_f, norm1_dx;
+    std::vector<int> iter, col;
+    std::vector<double> tmp;
+
+    SPGPanel(ptrdiff_t k, int nb) :
+        beta(k * nb), x(k * nb), x_old(k * nb), g(k * nb), g_old(k * nb), d(k * nb), Hd(k * nb),
+        old_fvals(MEM_OLD_VALUES * nb),
+        f(nb), fmin(nb), gtd(nb), red_f(nb), norm1_dx(nb),
+        iter(nb), col(nb),
+        tmp(k) {}
+
+    /* exchange the slots s1 and s2 */
+    void swap(ptrdiff_t k, int s1, int s2){
+        std::vector<double>* vecs[] = { &beta, &x, &x_old, &g, &g_old, &d };
+        for(std::vector<double>* v : vecs){
+            std::swap_ranges(v->begin() + s1 * k, v->begin() + (s1 + 1) * k, v->begin() + s2 * k);
+        }
+        std::swap_ranges(old_fvals.begin() + s1 * MEM_OLD_VALUES, old_fvals.begin() + (s1 + 1) * MEM_OLD_VALUES,
+                old_fvals.begin() + s2 * MEM_OLD_VALUES);
+        std::swap(f[s1], f[s2]);
+        std::swap(fmin[s1], fmin[s2]);
+        std::swap(gtd[s1], gtd[s2]);
+        std::swap(red_f[s1], red_f[s2]);
+        std::swap(norm1_dx[s1], norm1_dx[s2]);
+        std::swap(iter[s1], iter[s2]);
+        std::swap(col[s1], col[s2]);
+    }
+};
+
+/***  Solve a panel of Quadratic Problems by SPG ***/
+template <int K, class Projection>
+void SPGSolvePanel(const double* Hess, double L, const double* w, double shift, const double* a0,
+        ptrdiff_t k, int nb, Projection& proj, SPGPanel& P,
+        double* ahat, double* fhat, double* iters, double optTol){
+    /********
+     *
+     * solve for each of the nb clms:
+     *
+     *         min_a   a'* G * a - 2 * w'* a + shift * sum(a)
+     *         sb.to.  a in C (proj)
+     *
+     * The running clms occupy the leading slots of the panel,
+     * a clm that stops is swapped behind them.
+     *
+     * ---Input---
+     *
+     * Hess   - Hessian = 2 * G, constant
+     * L      - largest eigenvalue of Hess (GetLipschitz), the first
+     *          BB parameter is 1/L, 0 for the unit 1-norm first step
+     * w      - linear terms (k, nb)
+     * a0     - starting values (k, nb)
+     * k      - length of a clm, K if K > 0
+     * nb     - #clms, at most the capacity of P
+     * optTol - tolerance for stopping criterion
+     *
+     * ---Temporary Variables---
+     *
+     * P      - per clm state: beta = 2 * w - shift, x, x_old,
+     *          g = Hess * x - beta, g_old, d (descent direction), old_fvals, ...
+     *
+     * ---Output---
+     *
+     * ahat  - minimizers (k, nb)
+     * fhat  - objective values at ahat (nb)
+     * iters - #iterations used for each clm (nb), may be NULL
+     *
+     *******/
+
+    typedef SPGArith<K> Arith;
+    k = Arith::size(k);
+
+    /*** Initialiation ***/
+
+    // set parameter
+    double suffDec = SUFF_DESC;
+    int itermax = SPG_ITERMAX;
+
+    // #running clms
+    ptrdiff_t n = nb;
+
+    double* beta  = P.beta.data();
+    double* x     = P.x.data();
+    double* x_old = P.x_old.data();
+    double* g     = P.g.data();
+    double* g_old = P.g_old.data();
+    double* d     = P.d.data();
+    double* Hd    = P.Hd.data();
+    double* tmp   = P.tmp.data();
+
+    // set beta, starting points, gradients & fvals
+    for(ptrdiff_t i = 0; i < k * n; i++){
+        beta[i] = 2 * w[i] - shift;
+        x[i] = a0[i];
+    }
+    Arith::gemm(Hess, x, g, k, n);
+    for(ptrdiff_t i = 0; i < k * n; i++){
+        g[i] -= beta[i];
+    }
+
+    for(int s = 0; s < nb; s++){
+        P.col[s] = s;
+        P.iter[s] = 0;
+        // memory for non-monotone line search
+        for(int i = 0; i < MEM_OLD_VALUES; i++) {
+            P.old_fvals[s * MEM_OLD_VALUES + i] = -std::numeric_limits<double>::max();
+        }
+        // x' * G * x - beta' * x = 0.5 * x' * (g - beta)
+        double* xs = x + s * k;
+        P.f[s] = 0.5 * (Arith::dot(xs, g + s * k, k) - Arith::dot(xs, beta + s * k, k));
+        P.fmin[s] = P.f[s];
+
+        // copy to estimate
+        Arith::copy(xs, ahat + s * k, k);
+        fhat[s] = P.f[s];
+    }
+
+    /*** SPG Loop ***/
+
+    double alpha; // BB parameter
+    double t; //stepsize;
+    double f_ref; // reference function value in non-monotone linear search
+    double Linear, Quad; // ingredient to compute new function value;
+    double factor; // for linear search, factor to reduce stepsize
+    double Norm1_dx; // ||dx||_1, for linear search and as stopping criterion
+    double linear, quad, red_f, f_tmp, norm1_dx; //temporary variable in linear search
+
+    while (n > 0){
+
+        for(int s = 0; s < n; s++){
+            double* xs = x + s * k;
+            double* gs = g + s * k;
+            double* ds = d + s * k;
+
+            //** Compute Step Direction
+            if (P.iter[s] == 0)
+                // L comes from power iterations and may be an underestimate,
+                // so 1/L can overshoot: the line search backtracks then
+                alpha = (L > 0) ? 1 / L : 1;
+            else{
+                // alpha = (x - x_old)' * (x - x_old)  /  [ (x - x_old)' * (g - g_old)];
+                double* xo = x_old + s * k;
+                double* go = g_old + s * k;
+                double numerator = 0.0, denominator = 0.0;
+                for(ptrdiff_t i = 0; i < k; i++){
+                    double dx = xs[i] - xo[i];
+                    numerator += dx * dx;
+                    denominator += dx * (gs[i] - go[i]);
+                }
+                alpha = numerator / denominator;
+                if (alpha <= 1e-10 || alpha > 1e10) {
+                    alpha = 1;
+                }
+            }
+
+            //** Compute the projected step
+            // d = Proj(x - alpha * g) - x;
+            for(ptrdiff_t i = 0; i < k; i++){
+                ds[i] = xs[i] - alpha * gs[i];
+            }
+            proj(ds, k);
+            Arith::axpy(-1.0, xs, ds, k);
+
+            P.gtd[s] = Arith::dot(gs, ds, k);
+        }
+
+        //** Check that Progress can be made along the direction
+        for(int s = 0; s < n; ){
+            if (P.gtd[s] > -optTol){
+                if (iters) iters[P.col[s]] = P.iter[s];
+                P.swap(k, s, (int)--n);
+            }
+            else
+                s++;
+        }
+        if (n == 0)
+            break;
+
+        // __Hd = Hess * d for all the running clms
+        Arith::gemm(Hess, d, Hd, k, n);
+
+        for(int s = 0; s < n; s++){
+            double* ds = d + s * k;
+            double* xs = x + s * k;
+            double* fvals = P.old_fvals.data() + s * MEM_OLD_VALUES;
+            double gtd = P.gtd[s];
+            double f = P.f[s];
+            int iter = P.iter[s];
+
+            //** Backtracking Line Search
+            // Select Initial Guess to step length
+            // __the first direction is already scaled by 1/L
+            if (iter == 0 && L <= 0){
+                t = 1/Arith::asum(g + s * k, k);
+                t =  (t > 1) ? 1 : t;
+            }
+            else{
+                t = 1;
+            }
+
+            // Get the reference function value for non-monotone condition:
+            // __update the old_values memorized
+            if (iter < MEM_OLD_VALUES)
+                fvals[iter] = f;
+            else{
+                for(int i = 0; i < MEM_OLD_VALUES-1; i++){
+                    fvals[i] = fvals[i+1];
+                }
+                fvals[MEM_OLD_VALUES-1] = f;
+            }
+
+            // __find f_ref = max(old_fvals);
+            f_ref = fvals[0];
+            for(int i = 1; i < MEM_OLD_VALUES; i++){
+                if (f_ref < fvals[i])
+                    f_ref = fvals[i];
+            }
+
+            // ingredients for computing (f_new - f) based on stepsize t:
+            // __dx = t * d; Linear = g' * dx; Quad = dx' * Hess * dx;
+            // __equivalently, Linear = t * g' * d = t * gtd; Quad = t^2 * d' * Hess * d;
+            Linear = t * gtd;
+            Quad = Arith::dot(ds, Hd + s * k, k);
+            Quad = Quad * t * t;
+
+            // __|dx||_1
+            Norm1_dx = t * Arith::asum(ds, k);
+
+            // stepsize selection
+            factor = 1;
+            norm1_dx = Norm1_dx * factor;
+            while (1) {
+
+                //__compute (f_new - f)
+                linear = Linear * factor;
+                quad = Quad * factor * factor;
+                red_f = 0.5 * quad + linear;
+                f_tmp = f + red_f;
+
+                if (f_tmp < f_ref + suffDec * linear) {
+                    //__get sufficient descent
+                    t = t * factor;
+                    norm1_dx = Norm1_dx * factor;
+                    break;
+                }
+                else {
+                    //__Evaluate New Stepsize
+                    //__t = t * 0.5; -> t0 fixed; factor = factor * 0.5; t = t0 * factor;
+                    factor = factor * 0.5;
+                }
+
+                //__Check whether step has become too small
+                if (Norm1_dx * factor < optTol || t == 0) {
+                    t = 0;
+                    norm1_dx = 0;
+                    red_f = 0;
+                    break;
+                }
+
+            }
+            P.red_f[s] = red_f;
+            P.norm1_dx[s] = norm1_dx;
+
+            //** Take Step
+            // x_old = x; x = x + t * d;
+            Arith::copy(xs, x_old + s * k, k);
+            Arith::axpy(t, ds, xs, k);
+        }
+
+        // g_old = g; g = compute grad(x), all the running clms at once;
+        std::copy(g, g + k * n, g_old);
+        Arith::gemm(Hess, x, g, k, n);
+        for(ptrdiff_t i = 0; i < k * n; i++){
+            g[i] -= beta[i];
+        }
+
+        for(int s = 0; s < n; s++){
+            // new objective value and iteration index
+            P.f[s] = P.f[s] + P.red_f[s];
+            P.iter[s] = P.iter[s] + 1;
+
+            //** keep track of the minimum value attained
+            if ( P.f[s] < P.fmin[s] ){
+                P.fmin[s] = P.f[s]; // update
+                // copy to the estimate
+                Arith::copy(x + s * k, ahat + P.col[s] * k, k);
+                fhat[P.col[s]] = P.fmin[s];
+            }
+        }
+
+        for(int s = 0; s < n; ){
+            bool stop = P.norm1_dx[s] < optTol || std::fabs(P.red_f[s]) < optTol || P.iter[s] == itermax;
+
+            //** Check 1st order optimality condition
+            // tmp = Proj(x-g)-x;
+            if (!stop && Projection::firstOrderCheck) {
+                double* xs = x + s * k;
+                double* gs = g + s * k;
+                for(ptrdiff_t i = 0; i < k; i++){
+                    tmp[i] = xs[i] - gs[i];
+                }
+                proj(tmp, k);
+                Arith::axpy(-1.0, xs, tmp, k);
+                stop = Arith::asum(tmp, k) < optTol;
+            }
+
+            if (stop){
+                if (iters) iters[P.col[s]] = P.iter[s];
+                P.swap(k, s, (int)--n);
+            }
+            else
+                s++;
+        }
+    }
+}
+
+/* Some Voodoo magic to eliminate
+ * long switches for different dimensions */
+template <int ...> struct SPGDimList {};
+
+/*
+ * SPG for all the clms of W sharing the same G and feasible set,
+ * the Hessian, its Lipschitz estimate and the workspaces are set up
+ * once and reused by every call of solve (e.g. across D.C. steps)
+ */
+template <class Projection>
+class SPGSolver {
+public:
+    SPGSolver(const double* G, ptrdiff_t k, const Projection& proj, int nthreads = 1) :
+        k(k), nthreads(std::max(1, nthreads)), Hess(k * k),
+        projections(this->nthreads, proj), panels(this->nthreads, SPGPanel(k, SPG_PANEL)) {
+        // Hess = 2 * G
+        for(ptrdiff_t i = 0; i < k * k; i++){
+            Hess[i] = 2 * G[i];
+        }
+        L = Projection::lipschitzStep ? GetLipschitz(Hess.data(), k) : 0;
+    }
+
+    /*
+     * solve for the d clms of W (k,d) warm-started at A0 (k,d),
+     * minimizers go to Anew (k,d), #iterations to iters (d) unless NULL,
+     * returns the sum of the objective values
+     */
+    double solve(const double* W, double shift, const double* A0, int d,
+            double* Anew, double* iters, double optTol) {
+        fvals.resize(d);
+        dispatch(W, shift, A0, d, Anew, iters, optTol,
+                SPGDimList<2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16>());
+
+        double loss = 0.0;
+        for(int j = 0; j < d; j++){
+            loss = loss + fvals[j];
+        }
+        return loss;
+    }
+
+private:
+    /* border case, any k */
+    void dispatch(const double* W, double shift, const double* A0, int d,
+            double* Anew, double* iters, double optTol, SPGDimList<>) {
+        run<0>(W, shift, A0, d, Anew, iters, optTol);
+    }
+
+    template <int K, int ...KS>
+    void dispatch(const double* W, double shift, const double* A0, int d,
+            double* Anew, double* iters, double optTol, SPGDimList<K, KS...>) {
+        if (K != k) {
+            return dispatch(W, shift, A0, d, Anew, iters, optTol, SPGDimList<KS...>());
+        }
+        run<K>(W, shift, A0, d, Anew, iters, optTol);
+    }
+
+    template <int K>
+    void run(const double* W, double shift, const double* A0, int d,
+            double* Anew, double* iters, double optTol) {
+        /* no more threads than panels */
+        int npanels = (d + SPG_PANEL - 1) / SPG_PANEL;
+        int nth = std::max(1, std::min(nthreads, npanels));
+
+        // construct independet panels of subproblems
+        #pragma omp parallel for num_threads(nth) schedule(dynamic, 1)
+        for(int p = 0; p < npanels; p++){
+            int id = omp_get_thread_num();
+            int j = p * SPG_PANEL;
+            int nb = std::min(SPG_PANEL, d - j);
+            SPGSolvePanel<K>(Hess.data(), L, W + j * k, shift, A0 + j * k, k, nb,
+                    projections[id], panels[id],
+                    Anew + j * k, fvals.data() + j, iters ? iters + j : NULL, optTol);
+        }
+    }
+
+    ptrdiff_t k;
+    int nthreads;
+    std::vector<double> Hess;
+    double L;
+    std::vector<Projection> projections;
+    std::vector<SPGPanel> panels;
+    std::vector<double> fvals;
+};
+
+#endif /* _SPG_H */
@@ -0,0 +1,102 @@
+/*
+ * Projection onto the capped simplex {a : sum(a) == 1, l <= a <= u}
+ *
+ * The projection is a = min(max(x - tau, l), u) with sum(a) = 1.
+ * The sum is piecewise linear and non-increasing in tau,
+ * its breakpoints are x - u (a variable leaves its upper bound)
+ * and x - l (a variable reaches its lower bound).
+ * They are sorted and scanned once, so tau is exact and found
+ * in O(k log k), with no iterations to converge.
+ *
+ * Shared by RProjSplxBox, RQuadSimplexBox and the A-step
+ * of cppTAfact (in double or float).
+ */
+
+#ifndef _SPLXBOX_H
+#define _SPLXBOX_H
+
+#include <Rcpp.h>
+#include <algorithm>
+#include <utility>
+
+/*
+ * the capped simplex has to be well-defined and non-empty,
+ * nl and nu are the lengths of l and u, lname and uname
+ * their names in the error messages
+ */
+inline void CheckSplxBox(const double* l, int nl, const double* u, int nu, int k,
+        const char* lname = "l", const char* uname = "u") {
+    if (nl != k || nu != k) {
+        Rcpp::stop("%s and %s should have one bound per component", lname, uname);
+    }
+
+    double sumLower = 0.0, sumUpper = 0.0;
+    for (int i = 0; i < k; i++) {
+        if (l[i] > u[i]) {
+            Rcpp::stop("%s exceeds %s for component %d", lname, uname, i + 1);
+        }
+        sumLower += l[i];
+        sumUpper += u[i];
+    }
+    /* up to rounding, e.g. u = rep(0.1, 10) sums to slightly less than 1 */
+    double tol = 1e-12 * k;
+    if (sumLower > 1.0 + tol || sumUpper < 1.0 - tol) {
+        Rcpp::stop("no vector sums to one within %s and %s", lname, uname);
+    }
+}
+
+inline void CheckSplxBox(const Rcpp::NumericVector& l, const Rcpp::NumericVector& u, int k) {
+    CheckSplxBox(l.begin(), l.size(), u.begin(), u.size(), k);
+}
+
+/*
+ * tau of the projection of x onto the capped simplex,
+ * bp is a workspace of 2k breakpoints, l and u pass CheckSplxBox
+ */
+template <typename Scalar>
+inline Scalar SplxBoxThreshold(const Scalar* x, const Scalar* l, const Scalar* u,
+        std::pair<Scalar, int>* bp, int k) {
+    int nbp = 0;
+    Scalar sum = 0.0;
+    for (int i = 0; i < k; i++) {
+        bp[nbp++] = std::make_pair(x[i] - u[i], -1);
+        bp[nbp++] = std::make_pair(x[i] - l[i], +1);
+        sum += u[i];
+    }
+    std::sort(bp, bp + nbp);
+
+    /* sum(a) at the current breakpoint and its slope to the right */
+    Scalar slope = 0.0;
+    Scalar tau = bp[0].first;
+    if (sum <= 1.0) {
+        /* all at the upper bounds (sum(u) is 1 up to rounding) */
+        return tau;
+    }
+    for (int j = 0; j < nbp; j++) {
+        Scalar next = sum + slope * (bp[j].first - tau);
+        if (next <= 1.0) {
+            /* slope < 0 here, sum went from above 1 to next */
+            return tau + (sum - 1.0) / -slope;
+        }
+        sum = next;
+        tau = bp[j].first;
+        slope += bp[j].second;
+    }
+
+    /* all at the lower bounds, tau is the last breakpoint */
+    return tau;
+}
+
+/*
+ * project x onto the capped simplex -> output f (may be x),
+ * bp is a workspace of 2k breakpoints, l and u pass CheckSplxBox
+ */
+inline void ProjSplxBox(double* f, const double* x, const double* l, const double* u,
+        std::pair<double, int>* bp, int k) {
+    double tau = SplxBoxThreshold(x, l, u, bp, k);
+    for (int i = 0; i < k; i++) {
+        f[i] = std::min(std::max(x[i] - tau, l[i]), u[i]);
+    }
+}
+
+#endif /* _SPLXBOX_H */